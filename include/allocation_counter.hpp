@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+// Global heap allocation counter.
+// Only counts when built with CURVES_COUNT_ALLOCATIONS (see CMakeLists.txt),
+// which replaces the global operator new.
+
+namespace memory {
+
+bool heapAllocationCountingEnabled();
+
+// calls to operator new since startup, 0 when counting is disabled
+std::size_t heapAllocationCount();
+
+} // namespace memory
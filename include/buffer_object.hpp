@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
+
 #include <glad/glad.h>
 
 #include "object.hpp"
@@ -50,4 +53,11 @@ bool isValidBufferObjectType(BufferObject::Type type);
 
 BufferObject::Type enumToBufferObjectType(GLenum bufferObjectEnum);
 
+// Allocates bytes of storage for the buffer bound to target, maps it and
+// hands the pointer to fill. Mapping invalidates the old contents so it never
+// waits on a previous draw. If mapping fails or the storage is lost, fill
+// writes to a staging copy that is uploaded instead.
+void fillBufferMapped(GLenum target, std::size_t bytes, GLenum usage,
+                      std::function<void(void *data)> const &fill);
+
 } // namespace openGL
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "frame_arena.hpp"
+#include "obj_mesh.hpp"
+#include "vec3f.hpp"
+
+// Chaikin corner cutting on open control polygons.
+// Each level maps segment (p[i], p[i+1]) to the two points at 1/4 and 3/4,
+// so n points become 2 * (n - 1) points.
+
+namespace geometry {
+
+// below this many control points the serial path is faster
+constexpr std::size_t PARALLEL_SUBDIVISION_THRESHOLD = 8192;
+
+// working storage for subdivideOpenCurveRange(), reused between calls and
+// drawn from the arena so repeated rebuilds do not touch the heap
+struct SubdivisionScratch {
+  explicit SubdivisionScratch(memory::FrameArena &arena);
+
+  memory::ArenaVector<math::Vec3f> current;
+  memory::ArenaVector<math::Vec3f> next;
+  memory::ArenaVector<std::size_t> first;
+  memory::ArenaVector<std::size_t> last;
+};
+
+// number of points left after `depth` levels on `count` control points
+std::size_t subdividedOpenCurveSize(std::size_t count, int depth);
+
+Vertices subdivideOpenCurve(Vertices const &points, int depth);
+
+// The same into out, resized reusing its storage. The levels ping-pong
+// between out and scratch, so once both have grown to the curve's size a
+// subdivision allocates nothing. points and out must not be the same vector.
+void subdivideOpenCurve(Vertices const &points, int depth, Vertices &out,
+                        SubdivisionScratch &scratch);
+
+// Where subdivided point `index` (fractional for a point along a segment)
+// sits along the control polygon, in control point indices: the points of
+// each level are evenly spaced in this parameter, so it is
+// index / 2^depth + (1 - 1 / 2^depth) / 2. Its integer part is the control
+// span (points j, j + 1) that part of the curve was cut from.
+double controlPolygonParameter(double index, int depth);
+
+// Widens [first, last) from a range of the `count` control points to the
+// range of subdivided points that depend on them. Moving only those control
+// points leaves every subdivided point outside the result unchanged.
+void subdividedRangeAffectedBy(std::size_t count, int depth, std::size_t &first,
+                               std::size_t &last);
+
+// Writes points [first, last) of the subdivided curve to out without building
+// the rest of it. Only the control points that range depends on (plus a small
+// halo per level) are subdivided.
+void subdivideOpenCurveRange(Vertices const &points, int depth,
+                             std::size_t first, std::size_t last,
+                             math::Vec3f *out, SubdivisionScratch &scratch);
+
+// Threads for subdivideOpenCurveParallel(), each with its own scratch arena,
+// kept alive between calls: once the arenas have grown to the largest block,
+// a subdivision allocates nothing and starts no threads.
+// The calling thread takes a share of the blocks too, so threadCount == 1
+// runs everything on the caller; 0 uses hardware concurrency.
+class SubdivisionWorkers final {
+public:
+  explicit SubdivisionWorkers(unsigned int threadCount = 0);
+  ~SubdivisionWorkers();
+
+  SubdivisionWorkers(SubdivisionWorkers const &) = delete;
+  SubdivisionWorkers &operator=(SubdivisionWorkers const &) = delete;
+
+  // threads taking blocks, the caller included
+  unsigned int threadCount() const;
+
+private:
+  struct Job {
+    Vertices const *points = nullptr;
+    int depth = 0;
+    math::Vec3f *out = nullptr;
+    std::size_t outSize = 0;
+    std::size_t blockCount = 0;
+    std::atomic<std::size_t> nextBlock{0};
+  };
+
+  // worker's blocks of the current job, from its own arena
+  void runBlocks(std::size_t worker);
+  void workerLoop(std::size_t worker);
+
+  friend void subdivideOpenCurveParallel(Vertices const &points, int depth,
+                                         SubdivisionWorkers &workers,
+                                         Vertices &out);
+
+private:
+  // one per thread, the caller's last
+  std::vector<std::unique_ptr<memory::FrameArena>> m_arenas;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_mutex;
+  std::condition_variable m_started;
+  std::condition_variable m_finished;
+  std::size_t m_generation = 0; // jobs started
+  std::size_t m_running = 0;    // threads still working on the current job
+  bool m_stop = false;
+
+  Job m_job;
+};
+
+// Splits the final level into cache-sized blocks and runs every level of a
+// block (plus its halo of neighbouring input points) on one of workers'
+// threads, so each block reads its slice of the control polygon once and
+// writes its slice of the exact-size output once. out is resized, reusing its
+// storage.
+void subdivideOpenCurveParallel(Vertices const &points, int depth,
+                                SubdivisionWorkers &workers, Vertices &out);
+
+// the same on threads started for this call only
+Vertices subdivideOpenCurveParallel(Vertices const &points, int depth,
+                                    unsigned int threadCount = 0);
+
+} // namespace geometry
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include <glad/glad.h>
+
+#include "buffer_object.hpp"
+#include "frame_arena.hpp"
+#include "obj_mesh.hpp"
+#include "program.hpp"
+#include "vertex_array_object.hpp"
+
+// Transform feedback pipeline: subdivide -> revolve -> normals on the GPU.
+// Each Chaikin level is one pass of chaikin_feedback_vs.glsl, ping-ponging
+// between two buffers, and revolve_feedback_vs.glsl expands the final profile
+// into the revolved grid (see surface_of_revolution.hpp), captured straight
+// into the vertex buffer the draw path uses. Only the control points are
+// uploaded and nothing is read back. Everything is GL 3.3 core with rasterizer
+// discard and no fragment work, so it also runs on Mesa's llvmpipe
+// (LIBGL_ALWAYS_SOFTWARE=1).
+
+namespace opengl {
+
+class FeedbackRevolution final {
+public:
+  bool isValid() const;
+  explicit operator bool() const;
+
+  // Subdivides controlPoints depth times and revolves the result into
+  // vertexBuffer, reallocated only if it does not hold exactly
+  // revolvedGridVertexCount() interleaved LayoutVerticesNormals vertices.
+  // Returns the profile size, 0 if there was nothing to revolve. Picking the
+  // sweep direction (see geometry::revolutionSweep()) is the one pass over the
+  // profile left on the CPU, working storage for it comes from arena.
+  std::size_t revolve(geometry::Vertices const &controlPoints, int depth,
+                      BufferObject &vertexBuffer, memory::FrameArena &arena);
+
+private:
+  /* Only called through makeFeedbackRevolution() factory function */
+  FeedbackRevolution(Program chaikin, Program revolution);
+
+  friend FeedbackRevolution
+  makeFeedbackRevolution(std::string const &chaikinShaderSource,
+                         std::string const &revolutionShaderSource);
+
+  // points attribute `location` at the bound GL_ARRAY_BUFFER, `offset` bytes in
+  void pointAttribute(GLuint location, std::size_t offset, GLuint divisor);
+
+private:
+  Program m_chaikin;
+  Program m_revolution;
+  VertexArrayObject m_vao;
+  // ping-pong subdivision levels, each stored one point in so the end
+  // points can be repeated in front of and behind it
+  BufferObject m_levels[2];
+  std::size_t m_levelCapacity = 0;
+};
+
+FeedbackRevolution
+makeFeedbackRevolution(std::string const &chaikinShaderSource,
+                       std::string const &revolutionShaderSource);
+
+// How far a captured grid is from the CPU pipeline's
+struct FeedbackComparison {
+  std::size_t vertexCount = 0;
+  float maxPositionError = 0.f;
+  float maxNormalError = 0.f;
+};
+
+// Reads back vertexBuffer as left by FeedbackRevolution::revolve() and
+// compares it with geometry::revolveSubdividedCurve(). Stalls on the GPU,
+// meant for testing only.
+FeedbackComparison compareWithCPU(geometry::Vertices const &controlPoints,
+                                  int depth, BufferObject &vertexBuffer,
+                                  memory::FrameArena &arena);
+
+} // namespace opengl
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Open addressing (linear probing) map from 64 bit keys to 32 bit indices.
+// All slots live in one flat array, so a lookup is a hash and usually a
+// single cache line, and inserting never allocates unless the table grows.
+// The key ~size_t(0) is reserved to mark empty slots.
+
+namespace memory {
+
+class FlatIndexMap final {
+public:
+  explicit FlatIndexMap(std::size_t expectedSize = 0);
+
+  // Returns the index stored for key, inserting value first if key is new.
+  // second is true when the value was inserted.
+  std::pair<unsigned int, bool> findOrInsert(std::size_t key,
+                                             unsigned int value);
+
+  // pointer to the index stored for key, nullptr if key is not in the map
+  unsigned int *find(std::size_t key);
+  unsigned int const *find(std::size_t key) const;
+
+  std::size_t size() const;
+  void clear();
+
+private:
+  struct Slot {
+    std::size_t key;
+    unsigned int value;
+  };
+
+  void rehash(std::size_t slotCount);
+  std::size_t slotFor(std::size_t key) const;
+  std::size_t findSlot(std::size_t key) const;
+
+private:
+  std::vector<Slot> m_slots;
+  std::size_t m_size = 0;
+  unsigned int m_shift = 64;
+};
+
+} // namespace memory
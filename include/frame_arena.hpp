@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Bump-pointer arena for per-rebuild temporaries.
+// Allocation is a pointer bump, deallocation is a no-op and everything is
+// released at once by reset(). After a reset the chunks are merged into one,
+// so a rebuild of the same size as the last one never touches the heap.
+// Anything drawn from the arena must not outlive the next reset().
+
+namespace memory {
+
+class FrameArena final {
+public:
+  explicit FrameArena(std::size_t initialCapacity = 1 << 20);
+
+  // remove copy constructor/assignment
+  FrameArena(FrameArena const &) = delete;
+  FrameArena &operator=(FrameArena const &) = delete;
+
+  void *allocate(std::size_t bytes, std::size_t alignment);
+
+  void reset();
+
+  std::size_t bytesUsed() const;
+  std::size_t capacity() const;
+
+  // chunks requested from the heap since construction
+  std::size_t upstreamAllocations() const;
+
+private:
+  void addChunk(std::size_t minimumBytes);
+
+private:
+  std::vector<std::unique_ptr<char[]>> m_chunks;
+  std::vector<std::size_t> m_chunkSizes;
+  std::size_t m_current = 0; // chunk being bumped
+  std::size_t m_offset = 0;  // into the current chunk
+  std::size_t m_bytesUsed = 0;
+  std::size_t m_upstreamAllocations = 0;
+};
+
+// STL allocator drawing from a FrameArena
+template <typename T> class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(FrameArena &arena) : m_arena(&arena) {}
+
+  template <typename U>
+  ArenaAllocator(ArenaAllocator<U> const &other) : m_arena(other.arena()) {}
+
+  T *allocate(std::size_t n) {
+    return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  // released all at once by FrameArena::reset()
+  void deallocate(T *, std::size_t) {}
+
+  FrameArena *arena() const { return m_arena; }
+
+private:
+  FrameArena *m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(ArenaAllocator<T> const &lhs, ArenaAllocator<U> const &rhs) {
+  return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(ArenaAllocator<T> const &lhs, ArenaAllocator<U> const &rhs) {
+  return !(lhs == rhs);
+}
+
+template <typename T> using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+using ArenaUnorderedMap =
+    std::unordered_map<Key, Value, Hash, std::equal_to<Key>,
+                       ArenaAllocator<std::pair<Key const, Value>>>;
+
+} // namespace memory
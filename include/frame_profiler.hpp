@@ -0,0 +1,145 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Per stage frame timings, CPU and GPU
+// CPU stages are timed with the steady clock, GPU work with GL_TIME_ELAPSED
+// queries. The queries of a frame are read back two frames later, when the
+// GPU is done with them, so timing never waits on the GPU.
+// Every stage keeps its last samples, one per frame it ran in, and reports
+// their percentiles.
+
+namespace profiling {
+
+// The last `capacity` samples, in milliseconds
+class RollingSamples final {
+public:
+  explicit RollingSamples(std::size_t capacity = 512);
+
+  // overwrites the oldest sample once full
+  void record(double milliseconds);
+  void clear();
+
+  // samples kept, at most capacity
+  std::size_t count() const;
+
+  // nearest rank percentile of the kept samples, p in [0, 100], 0 if empty
+  double percentile(double p) const;
+  double max() const;
+
+private:
+  std::vector<double> m_samples;
+  std::size_t m_next = 0;
+  std::size_t m_count = 0;
+};
+
+class FrameProfiler final {
+public:
+  enum Stage {
+    SUBDIVISION,
+    REVOLVE,
+    NORMALS,
+    VBO_PACKING,
+    UPLOAD,
+    MESH_DRAW,
+    CONTROL_POINT_DRAW,
+    FRAME,
+    STAGE_COUNT
+  };
+
+  enum Clock { CPU, GPU, CLOCK_COUNT };
+
+  // Adds the steady clock time from construction to destruction to stage's
+  // time this frame. Scopes may nest, a nested stage's time also counts
+  // towards the enclosing one.
+  class CpuScope final {
+  public:
+    CpuScope(FrameProfiler &profiler, Stage stage);
+    ~CpuScope();
+
+    CpuScope(CpuScope const &) = delete;
+    CpuScope &operator=(CpuScope const &) = delete;
+
+  private:
+    FrameProfiler &m_profiler;
+    Stage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  // Adds the GPU time of the commands issued during its lifetime to stage's
+  // time this frame. GL allows one GL_TIME_ELAPSED query at a time, so a GPU
+  // scope nested in another is skipped (its time counts towards the outer
+  // one); none may overlap GL_TIME_ELAPSED queries made outside the profiler.
+  class GpuScope final {
+  public:
+    GpuScope(FrameProfiler &profiler, Stage stage);
+    ~GpuScope();
+
+    GpuScope(GpuScope const &) = delete;
+    GpuScope &operator=(GpuScope const &) = delete;
+
+  private:
+    FrameProfiler &m_profiler;
+    bool m_began; // false if nested in another GPU scope, which is skipped
+  };
+
+  explicit FrameProfiler(std::size_t window = 512);
+
+  // Starts a frame, reading back the GPU times of the frame two before.
+  // Needs the GL context current, as do GpuScope and release().
+  void beginFrame();
+
+  // records this frame's CPU times, for the stages that ran
+  void endFrame();
+
+  // Deletes the query objects, before the context goes away (they are not
+  // deleted by the destructor, which may run without a context)
+  void release();
+
+  RollingSamples const &samples(Stage stage, Clock clock) const;
+
+  // frames whose GPU times were not ready two frames later and were dropped
+  std::size_t droppedGpuFrames() const;
+
+  // p50/p95/p99/max of every stage with samples, one line per stage and clock
+  void print(std::ostream &out) const;
+
+  // the same as comma separated values, with a header line
+  void writeCSV(std::ostream &out) const;
+
+  static char const *stageName(Stage stage);
+
+private:
+  // the queries one frame issued for one stage, reused once read back
+  struct StageQueries {
+    std::vector<GLuint> queries;
+    std::size_t used = 0;
+  };
+
+  typedef std::array<StageQueries, STAGE_COUNT> QuerySet;
+
+  void addCpuTime(Stage stage, double milliseconds);
+  bool beginQuery(Stage stage);
+  void endQuery();
+  void resolve(QuerySet &set);
+
+private:
+  std::array<std::array<RollingSamples, CLOCK_COUNT>, STAGE_COUNT> m_samples;
+
+  // this frame's CPU time per stage, negative for stages that did not run
+  std::array<double, STAGE_COUNT> m_cpuFrame;
+
+  // double buffered, this frame's and the previous frame's
+  std::array<QuerySet, 2> m_querySets;
+  std::size_t m_frame = 0;
+  bool m_queryActive = false;
+  std::size_t m_droppedGpuFrames = 0;
+};
+
+} // namespace profiling
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Optional functionality past OpenGL 3.3 core
+// The entry points are looked up at runtime, so the program still runs
+// (without them) on drivers, and glad builds, that do not have them.
+
+namespace opengl {
+
+// GL_ARB_get_program_binary, core in 4.1
+constexpr GLenum PROGRAM_BINARY_RETRIEVABLE_HINT = 0x8257;
+constexpr GLenum PROGRAM_BINARY_LENGTH = 0x8741;
+constexpr GLenum NUM_PROGRAM_BINARY_FORMATS = 0x87FE;
+
+// GL_KHR_parallel_shader_compile (or the ARB version, same values)
+constexpr GLenum COMPLETION_STATUS = 0x91B1;
+constexpr GLuint MAX_SHADER_COMPILER_THREADS = 0xFFFFFFFF;
+
+struct Extensions {
+  // glGetProgramBinary/glProgramBinary, with at least one binary format
+  bool programBinary = false;
+  void(APIENTRYP getProgramBinary)(GLuint program, GLsizei bufSize,
+                                   GLsizei *length, GLenum *binaryFormat,
+                                   void *binary) = nullptr;
+  void(APIENTRYP loadProgramBinary)(GLuint program, GLenum binaryFormat,
+                                    void const *binary,
+                                    GLsizei length) = nullptr;
+  void(APIENTRYP programParameteri)(GLuint program, GLenum pname,
+                                    GLint value) = nullptr;
+
+  // compiles and links run on driver threads, COMPLETION_STATUS can be
+  // queried without blocking
+  bool parallelShaderCompile = false;
+  void(APIENTRYP maxShaderCompilerThreads)(GLuint count) = nullptr;
+};
+
+// Looks the extensions up in the current context, once after
+// gladLoadGLLoader
+void loadExtensions(GLADloadproc load);
+
+// what loadExtensions() found, nothing before it is called
+Extensions const &extensions();
+
+// name is in the current context's extension list
+bool hasExtension(char const *name);
+
+} // namespace opengl
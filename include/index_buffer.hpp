@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Index buffer formats
+// Indices are stored as GL_UNSIGNED_SHORT whenever every vertex (and the
+// primitive restart index, the largest value of the type) fits in 16 bits,
+// halving index bandwidth, and as GL_UNSIGNED_INT otherwise.
+
+namespace opengl {
+
+// Everything needed to draw what setup_vao_and_buffers uploaded
+struct IndexedDraw {
+  GLenum mode = GL_TRIANGLES;
+  GLenum indexType = GL_UNSIGNED_INT;
+  GLsizei count = 0;
+};
+
+// smallest index type that can address vertexCount vertices
+GLenum indexTypeFor(std::size_t vertexCount);
+
+std::size_t indexTypeSize(GLenum indexType);
+
+// all bits set, strips are separated by this index
+GLuint primitiveRestartIndex(GLenum indexType);
+
+// Index storage a generator writes into, of the type picked by indexTypeFor
+struct IndexBufferView {
+  GLenum type = GL_UNSIGNED_INT;
+  void *data = nullptr;
+
+  GLushort *shorts() const;
+  GLuint *ints() const;
+};
+
+// Fills the bound GL_ELEMENT_ARRAY_BUFFER, narrowing to 16 bits when
+// vertexCount allows
+IndexedDraw uploadIndices(std::vector<unsigned int> const &indices,
+                          std::size_t vertexCount, GLenum mode = GL_TRIANGLES,
+                          GLenum usage = GL_STATIC_DRAW);
+
+using FillIndices = std::function<void(IndexBufferView const &indices)>;
+
+// Allocates indexCount indices for vertexCount vertices in the bound
+// GL_ELEMENT_ARRAY_BUFFER and lets fill write them straight into the mapped
+// buffer, see fillBufferMapped()
+IndexedDraw uploadIndices(std::size_t vertexCount, std::size_t indexCount,
+                          GLenum mode, FillIndices const &fill,
+                          GLenum usage = GL_STATIC_DRAW);
+
+// Draws the bound VAO, strips are drawn with primitive restart enabled
+void drawIndexed(IndexedDraw const &draw);
+
+} // namespace opengl
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "buffer_object.hpp"
+#include "index_buffer.hpp"
+
+// GPU index buffers keyed by mesh topology
+// The indices of a grid mesh depend only on its dimensions and primitive
+// mode, never on the vertex positions, so while those stay the same (e.g.
+// dragging a control point at a fixed depth) only vertex data needs to be
+// uploaded again.
+
+namespace opengl {
+
+struct IndexBufferKey {
+  std::size_t rows = 0;
+  std::size_t columns = 0;
+  GLenum mode = GL_TRIANGLES;
+};
+
+bool operator==(IndexBufferKey const &lhs, IndexBufferKey const &rhs);
+bool operator!=(IndexBufferKey const &lhs, IndexBufferKey const &rhs);
+
+// indices of one topology and how to generate them
+struct IndexRequest {
+  IndexBufferKey key;
+  std::size_t count = 0;
+  FillIndices fill;
+};
+
+class IndexBufferCache final {
+public:
+  // number of topologies kept, the least recently used one is dropped
+  explicit IndexBufferCache(std::size_t capacity = 4);
+
+  // Binds the index buffer for request.key to GL_ELEMENT_ARRAY_BUFFER (i.e.
+  // into the bound VAO). request.fill is only called, and the indices only
+  // uploaded, the first time the key is seen.
+  IndexedDraw bind(IndexRequest const &request, std::size_t vertexCount);
+
+  void clear();
+
+  std::size_t hits() const;
+  std::size_t misses() const;
+
+  // total index data uploaded on misses
+  std::size_t bytesUploaded() const;
+
+private:
+  struct Entry {
+    IndexBufferKey key;
+    BufferObject buffer;
+    IndexedDraw draw;
+    std::size_t lastUse;
+  };
+
+private:
+  std::vector<Entry> m_entries; // few topologies, searched linearly
+  std::size_t m_capacity;
+  std::size_t m_uses = 0;
+  std::size_t m_hits = 0;
+  std::size_t m_misses = 0;
+  std::size_t m_bytesUploaded = 0;
+};
+
+} // namespace opengl
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Fixed bucket histogram of durations in milliseconds
+// Recording is an increment, with no allocation, so it can run every frame.
+// Percentiles are read back at bucket resolution.
+
+namespace profiling {
+
+class LatencyHistogram final {
+public:
+  // bucketCount buckets bucketWidth ms wide, from 0 ms; anything longer is
+  // counted in the last one
+  explicit LatencyHistogram(double bucketWidth = 1.0,
+                            std::size_t bucketCount = 100);
+
+  void record(double milliseconds);
+  void clear();
+
+  std::size_t count() const;
+  double max() const;
+
+  // upper edge of the bucket holding the p-th percentile, p in [0, 100]
+  double percentile(double p) const;
+
+  // share of samples no longer than milliseconds, at bucket resolution
+  double fractionWithin(double milliseconds) const;
+
+  // one line per non-empty bucket, with a bar scaled to the fullest one
+  void print(std::ostream &out) const;
+
+private:
+  std::size_t bucketOf(double milliseconds) const;
+
+private:
+  double m_bucketWidth;
+  std::vector<std::size_t> m_buckets;
+  std::size_t m_count = 0;
+  double m_max = 0.0;
+};
+
+} // namespace profiling
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// Lock-free single writer, single reader slot for the latest value
+// A seqlock: the writer never waits, it overwrites whatever is there, and the
+// reader retries if it raced with a store. Values the reader did not take in
+// time are lost, so it suits samples where only the newest matters (cursor
+// positions), not events that must all arrive (see SPSCQueue).
+// The value is kept in atomic words, so a torn read is a retry and never a
+// data race.
+
+namespace concurrency {
+
+template <typename T> class LatestValue final {
+public:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "the value is copied as raw words");
+
+  LatestValue() = default;
+
+  // remove copy constructor/assignment
+  LatestValue(LatestValue const &) = delete;
+  LatestValue &operator=(LatestValue const &) = delete;
+
+  // writer only, replaces the value
+  void store(T const &value);
+
+  // writer only, the reader took the last value stored (or none was)
+  bool taken() const;
+
+  // reader only, false if nothing was stored since the last take
+  bool take(T &value);
+
+private:
+  static constexpr std::size_t WORDS =
+      (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  // odd while a store is in progress, counts up by 2 per store
+  std::atomic<std::uint64_t> m_sequence{0};
+  // the sequence of the last value taken, written by the reader only
+  std::atomic<std::uint64_t> m_taken{0};
+  std::array<std::atomic<std::uint64_t>, WORDS> m_words{};
+};
+
+} // namespace concurrency
+
+#include "latest_value.tpp"
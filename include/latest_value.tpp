@@ -0,0 +1,59 @@
+#include "latest_value.hpp"
+
+#include <cstring>
+#include <thread>
+
+namespace concurrency {
+
+template <typename T> void LatestValue<T>::store(T const &value) {
+  std::uint64_t words[WORDS] = {};
+  std::memcpy(words, &value, sizeof(T));
+
+  auto sequence = m_sequence.load(std::memory_order_relaxed);
+  m_sequence.store(sequence + 1, std::memory_order_relaxed);
+  // the odd sequence is visible before any of the new words
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (std::size_t word = 0; word < WORDS; ++word) {
+    m_words[word].store(words[word], std::memory_order_relaxed);
+  }
+  // publishes the words with the even sequence
+  m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+template <typename T> bool LatestValue<T>::taken() const {
+  return m_taken.load(std::memory_order_acquire) ==
+         m_sequence.load(std::memory_order_relaxed);
+}
+
+template <typename T> bool LatestValue<T>::take(T &value) {
+  auto taken = m_taken.load(std::memory_order_relaxed);
+
+  for (;;) {
+    auto before = m_sequence.load(std::memory_order_acquire);
+    if (before == taken) {
+      return false;
+    }
+    if (before & 1) {
+      // a store is in progress, it is a handful of instructions, unless the
+      // writer was preempted in the middle of it
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::uint64_t words[WORDS];
+    for (std::size_t word = 0; word < WORDS; ++word) {
+      words[word] = m_words[word].load(std::memory_order_relaxed);
+    }
+    // the words are read before the sequence is checked again
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    if (m_sequence.load(std::memory_order_relaxed) == before) {
+      std::memcpy(&value, words, sizeof(T));
+      m_taken.store(before, std::memory_order_release);
+      return true;
+    }
+  }
+}
+
+} // namespace concurrency
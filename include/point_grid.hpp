@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "obj_mesh.hpp"
+#include "vec3f.hpp"
+
+namespace geometry {
+
+// 2D uniform grid over the x/y of a point array, for radius picking
+// The grid spans [-1, 1] x [-1, 1] (NDC) in cellsPerSide^2 cells, each
+// holding the indices of the points inside it; points outside are kept in
+// the border cells, so every point is still found. A query only visits the
+// cells its pick radius overlaps.
+// The grid mirrors the array's indices and is updated alongside every edit:
+// moving a point re-buckets only that point, inserting or erasing in the
+// middle renumbers the stored indices in one pass, as the array shifts.
+class PointGrid final {
+public:
+  static constexpr long NO_POINT = -1;
+
+  explicit PointGrid(unsigned int cellsPerSide = 64);
+
+  // replaces the contents with all of points
+  void build(Vertices const &points);
+
+  // point was inserted at index, the points after it moved up one
+  void insert(std::size_t index, math::Vec3f const &point);
+
+  // the point at index, at position point, was erased, the points after it
+  // moved down one
+  void erase(std::size_t index, math::Vec3f const &point);
+
+  // the point at index moved from `from` to `to`
+  void move(std::size_t index, math::Vec3f const &from, math::Vec3f const &to);
+
+  // Index of the point of points (which this grid mirrors) closest to (x, y)
+  // and no further than radius, NO_POINT if there is none. Ties go to the
+  // lowest index.
+  long nearest(Vertices const &points, float x, float y, float radius) const;
+
+  // number of points indexed
+  std::size_t size() const;
+
+private:
+  unsigned int cellCoordinate(float value) const;
+  std::size_t cellOf(math::Vec3f const &point) const;
+  void removeFromCell(std::size_t cell, std::size_t index);
+
+private:
+  unsigned int m_cellsPerSide;
+  float m_inverseCellSize;
+  std::vector<std::vector<std::uint32_t>> m_cells;
+  std::size_t m_size = 0;
+};
+
+} // namespace geometry
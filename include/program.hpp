@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include <glad/glad.h>
 
@@ -41,10 +42,27 @@ private:
   friend Program makeProgram(Shader const &vertexShader,
                              Shader const &fragmentShader);
 
+  friend Program makeProgramDeferred(Shader const &vertexShader,
+                                     Shader const &fragmentShader);
+
   friend Program makeProgram(Shader const &vertexShader,
                              Shader const &geometryShader,
                              Shader const &fragmentShader);
 
+  friend Program makeProgramFromBinary(GLenum binaryFormat,
+                                       void const *binary, GLsizei length);
+
+  friend Program
+  makeTransformFeedbackProgram(std::string const &vertexShaderSource,
+                               std::vector<std::string> const &varyings);
+
+  friend Program
+  makeTransformFeedbackProgram(Shader const &vertexShader,
+                               std::vector<std::string> const &varyings);
+
+  /* builds programs in stages, see program_queue.hpp */
+  friend class ProgramQueue;
+
 private:
   opengl::Object<Program> m_object;
 };
@@ -58,9 +76,34 @@ Program makeProgram(std::string const &vertexShaderSource,
 
 Program makeProgram(Shader const &vertexShader, Shader const &fragmentShader);
 
+// Issues the link without waiting for it (or for the shaders' compiles), check
+// it with checkLinkStatus() once the program is needed. The shaders may be
+// released right away, but keep them to report their compile errors.
+Program makeProgramDeferred(Shader const &vertexShader,
+                            Shader const &fragmentShader);
+
 Program makeProgram(Shader const &vertexShader, Shader const &geometryShader,
                     Shader const &fragmentShader);
 
+// Program linked from a binary saved by getProgramBinary(), invalid if the
+// binary is empty or rejected (e.g. after a driver update) or program
+// binaries are not supported, see gl_extensions.hpp
+Program makeProgramFromBinary(GLenum binaryFormat, void const *binary,
+                              GLsizei length);
+
+// Fills binary with program's linked binary, false if that is unavailable
+bool getProgramBinary(Program const &program, GLenum &binaryFormat,
+                      std::vector<char> &binary);
+
+// Vertex shader only program whose outputs `varyings` are captured,
+// interleaved in that order, into the bound transform feedback buffer.
+// Draw with GL_RASTERIZER_DISCARD enabled.
+Program makeTransformFeedbackProgram(std::string const &vertexShaderSource,
+                                     std::vector<std::string> const &varyings);
+
+Program makeTransformFeedbackProgram(Shader const &vertexShader,
+                                     std::vector<std::string> const &varyings);
+
 bool isValidProgramID(GLuint id);
 
 bool checkLinkStatus(GLuint programID);
@@ -74,4 +117,7 @@ void setUniformMat4f(GLuint uniformLocation, math::Mat4f const &value,
 
 void setUniform1f(GLuint uniformLocation, float value);
 
+// ints and sampler texture units
+void setUniform1i(GLuint uniformLocation, int value);
+
 } // namespace openGL
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "program.hpp"
+
+// Program binary cache
+// Linked programs are saved with glGetProgramBinary to one file per program
+// in a cache directory, named by a hash of the shader sources (including any
+// injected #defines) and the driver (vendor, renderer and version strings).
+// Later launches relink them with glProgramBinary instead of compiling,
+// falling back to compiling (and saving again) when there is no file, it was
+// written for other sources, or the driver rejects it.
+
+namespace opengl {
+
+class ProgramBinaryCache final {
+public:
+  // directory is created if missing, the driver is read from the current
+  // context
+  explicit ProgramBinaryCache(std::string const &directory);
+
+  // load(), or makeProgram() and save() when that fails
+  Program program(std::string const &vertexShaderSource,
+                  std::string const &fragmentShaderSource);
+
+  // the program saved for these sources, invalid if there is none (or it is
+  // stale)
+  Program load(std::string const &vertexShaderSource,
+               std::string const &fragmentShaderSource);
+
+  // saves program, just linked from these sources, for later launches
+  void save(std::string const &vertexShaderSource,
+            std::string const &fragmentShaderSource, Program const &program);
+
+  // programs relinked from a binary / compiled from source so far
+  std::size_t loaded() const;
+  std::size_t compiled() const;
+
+private:
+  std::uint64_t key(std::string const &vertexShaderSource,
+                    std::string const &fragmentShaderSource) const;
+  std::string path(std::uint64_t key) const;
+
+private:
+  std::string m_directory;
+  std::string m_driver;
+  std::size_t m_loaded = 0;
+  std::size_t m_compiled = 0;
+};
+
+} // namespace opengl
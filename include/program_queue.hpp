@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <string>
+
+#include "program.hpp"
+#include "program_binary_cache.hpp"
+#include "shader.hpp"
+
+// Lazy, batched program builds
+// Programs are added with their sources and nothing is compiled until one is
+// first used, so programs that are never used are never compiled. Programs
+// marked with prepare() are expected soon: the next program() (or issue())
+// call sends every prepared compile and link to the driver before any status
+// is queried, so the driver can overlap them (on its own threads with
+// GL_KHR_parallel_shader_compile), and only the program asked for is waited
+// on. With the extension, ready() tells whether that wait would block, so a
+// caller can keep using another program meanwhile.
+
+namespace opengl {
+
+class ProgramQueue final {
+public:
+  using Handle = std::size_t;
+
+  // binaries, when given, must outlive this
+  explicit ProgramQueue(ProgramBinaryCache *binaries = nullptr);
+
+  // Registers a program, compiles nothing. name is only used in logs.
+  Handle add(std::string const &name, std::string const &vertexShaderSource,
+             std::string const &fragmentShaderSource);
+
+  // the program is issued with the next issue() or program() call
+  void prepare(Handle handle);
+
+  // issues every prepared program's compiles and links, without waiting
+  void issue();
+
+  // Issues the program (and every prepared one) if it was not yet, and tells
+  // whether program() would return without waiting on the driver. Without
+  // GL_KHR_parallel_shader_compile there is no way to ask, it is always true.
+  bool ready(Handle handle);
+
+  // The linked program, issued together with every prepared one on first
+  // use and waited for. A failed program is kept invalid.
+  Program const &program(Handle handle);
+
+  // number of programs added
+  std::size_t size() const;
+
+private:
+  enum class BuildState { Added, Prepared, Issued, Done };
+
+  struct Sources {
+    std::string name;
+    std::string vertexShader;
+    std::string fragmentShader;
+    BuildState state;
+  };
+
+  // issued but not yet checked, the shaders are kept for their compile logs
+  struct Pending {
+    Shader vertexShader;
+    Shader fragmentShader;
+    Program program;
+  };
+
+  void issue(Handle handle);
+  void finish(Handle handle);
+
+private:
+  ProgramBinaryCache *m_binaries;
+  std::deque<Sources> m_sources;
+  std::map<Handle, Pending> m_pending;
+  // node based, so references returned by program() stay valid
+  std::map<Handle, Program> m_programs;
+};
+
+} // namespace opengl
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "obj_mesh.hpp"
+#include "vec3f.hpp"
+
+namespace geometry {
+
+// Closest point on a polyline, see SegmentBVH::nearest()
+struct SegmentHit {
+  std::size_t segment = 0; // between points segment and segment + 1
+  float t = 0.f;           // along the segment, 0 .. 1
+  math::Vec3f point;
+  float distance2 = 0.f; // squared, in x/y
+};
+
+// Bounding volume hierarchy over the segments of a polyline, in x/y
+// Consecutive segments of a curve are close to each other, so the tree
+// splits the segment range in halves instead of sorting by position: every
+// node covers a contiguous run of segments, with the 2D box around them, and
+// the whole tree is built in linear time. Nearest-segment queries descend
+// into the closer child first and skip every node whose box is further away
+// than the best hit so far, visiting O(log n) nodes for a curve that does not
+// fold back over itself.
+class SegmentBVH final {
+public:
+  // replaces the contents with the segments of polyline (copied)
+  void build(Vertices const &polyline);
+
+  // Closest point to (x, y) on any segment no further than radius, false if
+  // there is none
+  bool nearest(float x, float y, float radius, SegmentHit &hit) const;
+
+  std::size_t segmentCount() const;
+
+private:
+  struct Node {
+    float minX, minY, maxX, maxY;
+    std::uint32_t first; // first segment, or the left child of an inner node
+    std::uint32_t count; // segments of a leaf, 0 for an inner node
+  };
+
+  void buildNode(std::uint32_t node, std::uint32_t first, std::uint32_t count);
+  void nearestIn(std::uint32_t node, float x, float y, SegmentHit &best,
+                 bool &found) const;
+
+private:
+  Vertices m_points;
+  // the children of an inner node are stored next to each other
+  std::vector<Node> m_nodes;
+};
+
+} // namespace geometry
@@ -35,6 +35,8 @@ private:
 
   friend Shader makeShader(std::string const &shaderCode,
                            Shader::Type shaderType);
+  friend Shader makeShaderDeferred(std::string const &shaderCode,
+                                   Shader::Type shaderType);
   friend void swap(Shader &lhs, Shader &rhs);
 
 private:
@@ -44,6 +46,10 @@ private:
 
 Shader makeShader(std::string const &shaderCode, GLenum shaderType);
 
+// Issues the compile without waiting for it, check it with
+// checkCompileStatus() once the result is needed
+Shader makeShaderDeferred(std::string const &shaderCode, GLenum shaderType);
+
 void swap(Shader &lhs, Shader &rhs);
 
 Shader::Type enumToShaderType(GLenum shaderTypeEnum);
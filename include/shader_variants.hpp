@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include "program.hpp"
+#include "program_queue.hpp"
+
+// Shader permutations
+// One vertex/fragment source pair covers every configuration; a
+// ShaderFeatures value picks a permutation by the #defines it injects right
+// after the #version line, e.g.
+//   #define PACKED_VERTICES
+//   #define LIGHT_COUNT 2
+// so each draw runs a program with only the code its configuration needs,
+// instead of branching at runtime. ProgramVariants adds a permutation to a
+// ProgramQueue the first time it is asked for (or prepared), keyed by the
+// feature bits, and the queue compiles it on first use.
+
+namespace opengl {
+
+struct ShaderFeatures {
+  enum Flag : unsigned {
+    NONE = 0,
+    FLAT_SHADING = 1u << 0,     // normals from screen space derivatives
+    PACKED_VERTICES = 1u << 1,  // 16-bit positions and octahedral normals
+    REVOLVED_PROFILE = 1u << 2, // instanced grid from the profile texture,
+                                // analytic normals
+  };
+
+  enum : unsigned { MAX_LIGHTS = 4 };
+
+  unsigned flags = NONE;
+  unsigned lightCount = 1; // 1 .. MAX_LIGHTS
+
+  // flags in the low byte, the light count above
+  unsigned key() const;
+
+  // the #define lines for these features
+  std::string defines() const;
+};
+
+// Inserts defines after the #version line of source (or in front of it if
+// there is none), followed by a #line directive so compile errors still
+// report the original line numbers
+std::string injectDefines(std::string const &source,
+                          std::string const &defines);
+
+class ProgramVariants final {
+public:
+  // Sources are loaded once, here. Permutations are built by queue, which
+  // must outlive this.
+  ProgramVariants(std::string const &vertexShaderFile,
+                  std::string const &fragmentShaderFile, ProgramQueue &queue);
+
+  // features will be drawn with soon, see ProgramQueue::prepare()
+  void prepare(ShaderFeatures const &features);
+
+  // program(features) would not wait on the driver, see ProgramQueue::ready()
+  bool ready(ShaderFeatures const &features);
+
+  // The program for features, compiled and linked on first use. A failed
+  // permutation is kept (invalid) so it is not recompiled every frame.
+  Program const &program(ShaderFeatures const &features);
+
+  // number of permutations added to the queue so far
+  std::size_t size() const;
+
+private:
+  ProgramQueue::Handle handle(ShaderFeatures const &features);
+
+private:
+  std::string m_vertexShaderFile;
+  std::string m_fragmentShaderFile;
+  std::string m_vertexSource;
+  std::string m_fragmentSource;
+  ProgramQueue &m_queue;
+  std::map<unsigned, ProgramQueue::Handle> m_handles;
+};
+
+} // namespace opengl
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Lock-free single producer, single consumer queue
+// A fixed ring of Capacity slots. One thread may push() and one other thread
+// may pop(), concurrently, without locks: each side owns one index and only
+// reads the other's, with acquire/release ordering handing the slot over.
+// Neither call ever blocks or allocates; push() fails when the ring is full.
+
+namespace concurrency {
+
+template <typename T, std::size_t Capacity> class SPSCQueue final {
+public:
+  static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0,
+                "the capacity must be a power of two");
+
+  SPSCQueue() = default;
+
+  // remove copy constructor/assignment
+  SPSCQueue(SPSCQueue const &) = delete;
+  SPSCQueue &operator=(SPSCQueue const &) = delete;
+
+  // producer only, false (and value dropped) when full
+  bool push(T const &value);
+
+  // consumer only, false when empty
+  bool pop(T &value);
+
+  // either side, a snapshot that may be stale by the time it is used
+  bool empty() const;
+
+private:
+  static constexpr std::size_t CACHE_LINE = 64;
+
+  std::array<T, Capacity> m_slots;
+  // next slot to pop, written by the consumer only
+  alignas(CACHE_LINE) std::atomic<std::size_t> m_head{0};
+  // next slot to push, written by the producer only
+  alignas(CACHE_LINE) std::atomic<std::size_t> m_tail{0};
+};
+
+} // namespace concurrency
+
+#include "spsc_queue.tpp"
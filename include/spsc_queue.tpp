@@ -0,0 +1,40 @@
+#include "spsc_queue.hpp"
+
+namespace concurrency {
+
+// The indices count up forever and are masked into the ring, so a full ring
+// (tail - head == Capacity) and an empty one (tail == head) differ
+
+template <typename T, std::size_t Capacity>
+bool SPSCQueue<T, Capacity>::push(T const &value) {
+  auto tail = m_tail.load(std::memory_order_relaxed);
+  if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+    return false;
+  }
+
+  m_slots[tail & (Capacity - 1)] = value;
+  // publishes the slot to the consumer
+  m_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, std::size_t Capacity>
+bool SPSCQueue<T, Capacity>::pop(T &value) {
+  auto head = m_head.load(std::memory_order_relaxed);
+  if (head == m_tail.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  value = m_slots[head & (Capacity - 1)];
+  // hands the slot back to the producer
+  m_head.store(head + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T, std::size_t Capacity>
+bool SPSCQueue<T, Capacity>::empty() const {
+  return m_head.load(std::memory_order_acquire) ==
+         m_tail.load(std::memory_order_acquire);
+}
+
+} // namespace concurrency
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "frame_arena.hpp"
+#include "obj_mesh.hpp"
+#include "vec3f.hpp"
+
+// Revolved grid: the subdivided profile swept around the y axis in
+// REVOLUTION_SLICES steps. Vertex (slice, j) lives at slice * profileSize + j,
+// so every slice is one contiguous row of the profile.
+// The sweep direction is picked from the profile (see revolutionSweep()), so
+// triangles always wind counter-clockwise and normals always point outward,
+// whichever way the profile was drawn.
+
+namespace geometry {
+
+constexpr unsigned int REVOLUTION_SLICES = 72;
+constexpr float REVOLUTION_STEP_DEGREES = 360.f / REVOLUTION_SLICES;
+
+std::size_t revolvedGridVertexCount(std::size_t profileSize);
+std::size_t revolvedGridIndexCount(std::size_t profileSize);
+
+// one strip per slice plus the restart indices between them
+std::size_t revolvedGridStripIndexCount(std::size_t profileSize);
+
+// +1 or -1, the direction the profile is swept in so the revolved surface
+// faces outward. Outside is where the signed volume the profile sweeps out,
+// pi * integral of x^2 dy, is positive: sweeping with +1 faces outward when
+// the profile runs down the axis on balance.
+float revolutionSweep(Vertices const &profile);
+
+// The same for the profile after `depth` levels of subdivision, produced a
+// block at a time (the control polygon's own volume can have the other sign)
+float revolutionSweep(Vertices const &controlPoints, int depth,
+                      memory::FrameArena &arena);
+
+// The signed volume revolutionSweep() decides on, kept per block of profile
+// segments so an edit only subdivides the blocks its rows fall in again.
+// The blocks are summed in the same order, so sweep() always agrees with
+// revolutionSweep().
+class SweptVolume final {
+public:
+  // the whole profile after `depth` levels of subdivision
+  void compute(Vertices const &controlPoints, int depth,
+               memory::FrameArena &arena);
+
+  // Profile rows [first, last) moved since the last compute() or update(),
+  // which had as many control points and the same depth
+  void update(Vertices const &controlPoints, int depth, std::size_t first,
+              std::size_t last, memory::FrameArena &arena);
+
+  double volume() const;
+  float sweep() const;
+
+private:
+  std::vector<double> m_blocks;
+};
+
+// True when the subdivided profile starts and ends on the y axis, so the
+// revolved surface has no holes at the poles and its inside can never be
+// seen. Open subdivision ends between the first two and between the last two
+// control points at every depth, so only those four are tested, within a
+// tolerance relative to the profile's extent
+bool revolvedSurfaceIsClosed(Vertices const &controlPoints);
+
+// Fused subdivide -> revolve -> normals. The profile is produced a small block
+// at a time straight from the control points, so neither the subdivided curve
+// nor the rotated copies are ever materialized. Each grid vertex is handed to
+// write(index, position, normal) exactly once, in order within each slice,
+// so write may store (or pack) it straight into mapped GPU memory.
+// sweep is the profile's revolutionSweep(), computed once by the caller
+// rather than by every call. Working blocks are drawn from arena.
+template <typename Writer>
+void revolveSubdividedCurve(Vertices const &controlPoints, int depth,
+                            float sweep, Writer &&write,
+                            memory::FrameArena &arena);
+
+// As above, for profile rows [first, last) of every slice only
+template <typename Writer>
+void revolveSubdividedCurveRange(Vertices const &controlPoints, int depth,
+                                 float sweep, std::size_t first,
+                                 std::size_t last, Writer &&write,
+                                 memory::FrameArena &arena);
+
+// Widens [first, last) from a range of control points to the profile rows
+// whose positions or normals depend on them
+void revolvedGridRowsAffectedBy(std::size_t controlPointCount, int depth,
+                                std::size_t &first, std::size_t &last);
+
+// verticesOut and normalsOut need room for revolvedGridVertexCount() entries,
+// the sweep is worked out here
+void revolveSubdividedCurve(Vertices const &controlPoints, int depth,
+                            math::Vec3f *verticesOut, math::Vec3f *normalsOut,
+                            memory::FrameArena &arena);
+
+// conservative bounds of the revolved grid, from the control points alone
+void revolvedGridBounds(Vertices const &controlPoints, math::Vec3f &boundsMin,
+                        math::Vec3f &boundsMax);
+
+// Two triangles per grid cell, with the same winding as createTriangleMesh,
+// ordered in narrow bands for post-transform cache reuse.
+// indicesOut needs room for revolvedGridIndexCount() entries.
+void makeRevolvedGridIndices(std::size_t profileSize,
+                             unsigned short *indicesOut);
+void makeRevolvedGridIndices(std::size_t profileSize, unsigned int *indicesOut);
+
+// The same triangles as a triangle strip per slice, strips separated by the
+// largest index value (the primitive restart index).
+// indicesOut needs room for revolvedGridStripIndexCount() entries.
+void makeRevolvedGridStripIndices(std::size_t profileSize,
+                                  unsigned short *indicesOut);
+void makeRevolvedGridStripIndices(std::size_t profileSize,
+                                  unsigned int *indicesOut);
+
+} // namespace geometry
+
+#include "surface_of_revolution.tpp"
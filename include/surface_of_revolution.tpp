@@ -0,0 +1,111 @@
+#include "surface_of_revolution.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+#include "curve_subdivision.hpp"
+
+namespace geometry {
+
+namespace revolution_detail {
+
+// profile points per block, small enough that the block, its normals and
+// the subdivision scratch stay in L1/L2 while all slices are written
+constexpr std::size_t BLOCK_SIZE = 256;
+
+// Normal of the swept surface in the profile (z = 0) plane.
+// The sweep direction at angle 0 is sweep * (0, 0, -x), so
+// tangent ^ sweep = sweep * x * (-ty, tx, 0), matching the face normals of
+// the triangles built by createTriangleMesh.
+inline math::Vec3f profileNormal(math::Vec3f const &prev,
+                                 math::Vec3f const &point,
+                                 math::Vec3f const &next, float sweep) {
+  math::Vec3f tangent = next - prev;
+  float side = point.x < 0.f ? -sweep : sweep;
+  math::Vec3f n(-tangent.y * side, tangent.x * side, 0.f);
+  float length = norm(n);
+  return length > 0.f ? n / length : n;
+}
+
+// rotation about the y axis, same convention as math::rotateAroundAxis
+struct SliceRotation {
+  float cosTheta = 1.f;
+  float sinTheta = 0.f;
+
+  math::Vec3f operator()(math::Vec3f const &v) const {
+    return math::Vec3f(v.x * cosTheta + v.z * sinTheta, v.y,
+                       v.z * cosTheta - v.x * sinTheta);
+  }
+};
+
+// slice angles step by sweep * REVOLUTION_STEP_DEGREES
+std::array<SliceRotation, REVOLUTION_SLICES> sliceRotations(float sweep);
+
+} // namespace revolution_detail
+
+template <typename Writer>
+void revolveSubdividedCurve(Vertices const &controlPoints, int depth,
+                            float sweep, Writer &&write,
+                            memory::FrameArena &arena) {
+  revolveSubdividedCurveRange(
+      controlPoints, depth, sweep, 0,
+      subdividedOpenCurveSize(controlPoints.size(), depth),
+      std::forward<Writer>(write), arena);
+}
+
+template <typename Writer>
+void revolveSubdividedCurveRange(Vertices const &controlPoints, int depth,
+                                 float sweep, std::size_t rangeFirst,
+                                 std::size_t rangeLast, Writer &&write,
+                                 memory::FrameArena &arena) {
+  using namespace revolution_detail;
+
+  auto profileSize = subdividedOpenCurveSize(controlPoints.size(), depth);
+  rangeLast = std::min(rangeLast, profileSize);
+  if (profileSize < 2 || rangeFirst >= rangeLast) {
+    return;
+  }
+
+  // one rotation per slice, shared by every block
+  auto const rotations = sliceRotations(sweep);
+
+  SubdivisionScratch scratch(arena);
+  // block plus one neighbour on each side
+  memory::ArenaVector<math::Vec3f> profile(
+      BLOCK_SIZE + 2, memory::ArenaAllocator<math::Vec3f>(arena));
+  memory::ArenaVector<math::Vec3f> normals(
+      BLOCK_SIZE, memory::ArenaAllocator<math::Vec3f>(arena));
+
+  for (auto first = rangeFirst; first < rangeLast; first += BLOCK_SIZE) {
+    auto last = std::min(first + BLOCK_SIZE, rangeLast);
+    auto haloFirst = first > 0 ? first - 1 : 0;
+    auto haloLast = std::min(last + 1, profileSize);
+
+    subdivideOpenCurveRange(controlPoints, depth, haloFirst, haloLast,
+                            profile.data(), scratch);
+
+    // central differences, one sided at the ends of the profile
+    for (auto j = first; j < last; ++j) {
+      auto local = j - haloFirst;
+      auto prev = j > 0 ? local - 1 : local;
+      auto next = j + 1 < profileSize ? local + 1 : local;
+      normals[j - first] =
+          profileNormal(profile[prev], profile[local], profile[next], sweep);
+    }
+
+    // sweep the block through every slice
+    auto count = last - first;
+    auto const *points = &profile[first - haloFirst];
+    for (unsigned int slice = 0; slice < REVOLUTION_SLICES; ++slice) {
+      auto const &rotation = rotations[slice];
+      auto base = slice * profileSize + first;
+
+      for (std::size_t k = 0; k < count; ++k) {
+        write(base + k, rotation(points[k]), rotation(normals[k]));
+      }
+    }
+  }
+}
+
+} // namespace geometry
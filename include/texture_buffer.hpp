@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+#include "buffer_object.hpp"
+#include "texture.hpp"
+
+// Buffer textures (GL_TEXTURE_BUFFER)
+// A buffer object a shader reads through a samplerBuffer with texelFetch,
+// for data indexed by gl_VertexID/gl_InstanceID rather than fed as vertex
+// attributes. GL 3.3 has no three component float formats here, so vec3 data
+// is stored as GL_R32F and fetched one component at a time.
+
+namespace opengl {
+
+class TextureBuffer final {
+public:
+  // replaces the contents, the old storage is orphaned so this never waits on
+  // a draw still reading it
+  void upload(void const *data, std::size_t bytes,
+              GLenum usage = GL_DYNAMIC_DRAW);
+
+  // binds the texture to texture unit GL_TEXTURE0 + unit
+  void bind(GLuint unit) const;
+
+  std::size_t bytes() const;
+
+private:
+  /* Only called through makeTextureBuffer() factory function */
+  TextureBuffer(BufferObject buffer, Texture texture);
+
+  friend TextureBuffer makeTextureBuffer(GLenum internalFormat);
+
+private:
+  BufferObject m_buffer;
+  Texture m_texture;
+  std::size_t m_bytes = 0;
+};
+
+TextureBuffer makeTextureBuffer(GLenum internalFormat);
+
+// largest number of texels a buffer texture may address
+std::size_t maxTextureBufferTexels();
+
+} // namespace opengl
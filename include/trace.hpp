@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped trace events, written as a Chrome trace (chrome://tracing, Perfetto)
+// A TraceScope records when it was entered and left, on the thread it runs
+// on, while a trace is being captured. Otherwise it costs one relaxed atomic
+// load. Each thread records into its own buffer, so threads only contend
+// with the writer at the end of a capture.
+// A capture covers a window of frames: startTrace() clears what was recorded
+// before and turns recording on, traceFrameEnd() counts frames and writes the
+// trace file once the window is over.
+
+namespace profiling {
+
+namespace trace_detail {
+
+extern std::atomic<bool> enabled;
+
+// nanoseconds since the process started
+std::int64_t now();
+
+void record(char const *category, char const *name, std::int64_t start,
+            std::int64_t end);
+
+} // namespace trace_detail
+
+// a capture is running
+inline bool tracing() {
+  return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+// category and name must outlive the capture (string literals), only the
+// pointers are stored
+class TraceScope final {
+public:
+  TraceScope(char const *category, char const *name)
+      : m_category(category), m_name(name),
+        m_start(tracing() ? trace_detail::now() : NOT_RECORDING) {}
+
+  ~TraceScope() {
+    if (m_start != NOT_RECORDING) {
+      trace_detail::record(m_category, m_name, m_start, trace_detail::now());
+    }
+  }
+
+  TraceScope(TraceScope const &) = delete;
+  TraceScope &operator=(TraceScope const &) = delete;
+
+private:
+  static constexpr std::int64_t NOT_RECORDING = -1;
+
+  char const *m_category;
+  char const *m_name;
+  std::int64_t m_start;
+};
+
+// names the calling thread's track in the trace
+void setTraceThreadName(std::string const &name);
+
+// Starts capturing the next frames frames (see traceFrameEnd()) into
+// filename, dropping anything recorded before. A capture in progress is
+// restarted.
+void startTrace(std::size_t frames, std::string const &filename);
+
+// Marks the end of a frame. The capture stops and is written when its last
+// frame ends.
+void traceFrameEnd();
+
+// stops a capture in progress early and writes what it recorded, if any
+void stopTrace();
+
+} // namespace profiling
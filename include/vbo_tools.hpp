@@ -1,40 +1,54 @@
 #pragma once
 
+#include <cstddef>
+#include <functional>
 #include <vector>
 
 #include "obj_mesh_file_io.hpp"
 #include "vec3f.hpp"
 #include "vec2f.hpp"
 #include "buffer_object.hpp"
+#include "frame_arena.hpp"
+#include "index_buffer.hpp"
+#include "index_buffer_cache.hpp"
 #include "vertex_array_object.hpp"
+#include "vertex_cache.hpp"
+#include "vertex_layout.hpp"
+#include "vertex_packing.hpp"
 
 namespace opengl {
 
 using Indices = std::vector<unsigned int>;
 
-struct VBOData_Vertices {
-  Indices indices;
-  geometry::Vertices vertices;
-};
+// the formats of the structs below, in the order their arrays are uploaded
+using LayoutVerticesNormals = VertexLayout<Position, Normal>;
+using LayoutVerticesNormalsTextureCoords = VertexLayout<Position, Normal, UV>;
+using LayoutPackedVerticesNormals =
+    VertexLayout<QuantizedPosition, OctahedralNormal>;
 
-struct VBOData_VerticesNormals {
-  Indices indices;
-  geometry::Vertices vertices;
-  geometry::Normals normals;
-};
+// indices plus the arrays the layouts generate (see VertexData)
+using VBOData_Vertices = VertexData<VertexLayout<Position>>;
+using VBOData_VerticesNormals = VertexData<LayoutVerticesNormals>;
+using VBOData_VerticesTexutreCoordsNormals =
+    VertexData<LayoutVerticesNormalsTextureCoords>;
 
-struct VBOData_VerticesTexutreCoordsNormals {
-  Indices indices;
-  geometry::Vertices vertices;
-  geometry::TextureCoords textureCoords;
-  geometry::Normals normals;
+// [ unorm16 positions | octahedral snorm16 normals ], half the size of
+// VBOData_VerticesNormals. Positions decode with quantization.
+struct VBOData_PackedVerticesNormals
+    : VertexData<LayoutPackedVerticesNormals> {
+  PositionQuantization quantization;
 };
 
 // converts OBJ-like data
 // (e.g. f 12/3/90 11/4/91 10/20/30 -> 0 [v,n,uv] 1 [v,n,uv] 2 [v,n,uv]
 // so as to be condusive for vertex element buffers
+// The OBJMesh && overloads move the vertices out of the mesh instead of
+// copying them, and the per-vertex normals are taken by value so callers can
+// move those in as well.
 VBOData_Vertices makeConsistentVertexIndices(geometry::OBJMesh const &mesh);
 
+VBOData_Vertices makeConsistentVertexIndices(geometry::OBJMesh &&mesh);
+
 VBOData_VerticesNormals
 makeConsistentVertexNormalIndices(geometry::OBJMesh const &mesh);
 
@@ -42,6 +56,10 @@ VBOData_VerticesNormals
 makeConsistentVertexNormalIndices(geometry::OBJMesh const &mesh,
                                   geometry::Normals vertexNormals);
 
+VBOData_VerticesNormals
+makeConsistentVertexNormalIndices(geometry::OBJMesh &&mesh,
+                                  geometry::Normals vertexNormals);
+
 VBOData_VerticesTexutreCoordsNormals
 makeConsistentVertexTextureCoordNormalIndices(geometry::OBJMesh const &mesh);
 
@@ -49,15 +67,130 @@ VBOData_VerticesTexutreCoordsNormals
 makeConsistentVertexTextureCoordNormalIndices(
     geometry::OBJMesh const &mesh, geometry::Normals const &vertexNormals);
 
-unsigned int setup_vao_and_buffers(opengl::VertexArrayObject &vao,
-                                   opengl::BufferObject &indexBuffer,
-                                   opengl::BufferObject &vertexBuffer,
-                                   opengl::VBOData_VerticesNormals const &data);
+VBOData_PackedVerticesNormals
+packVerticesNormals(VBOData_VerticesNormals const &data);
+
+VBOData_PackedVerticesNormals
+packVerticesNormals(VBOData_VerticesNormals &&data);
+
+// Index order optimization (cache size in vertex_cache.hpp)
+
+// average cache miss ratio, vertex shader runs per triangle through a FIFO
+// cache (1.0 to 3.0 for unoptimized meshes, ~0.5 to 0.7 when optimized)
+float averageCacheMissRatio(Indices const &indices, std::size_t vertexCount,
+                            unsigned int cacheSize = VERTEX_CACHE_SIZE);
+
+// reorders triangles for post-transform cache reuse (Forsyth's linear-speed
+// vertex cache optimization)
+void optimizeVertexCache(Indices &indices, std::size_t vertexCount);
+
+// Splits the triangle order into clusters at cache flush points and sorts
+// the clusters so those facing outward from the mesh centre draw first,
+// letting early depth test reject more of what is behind them.
+void optimizeOverdraw(Indices &indices, geometry::Vertices const &vertices);
+
+// reorders vertices by first use so fetches walk memory forward, unused
+// vertices are dropped
+void optimizeVertexFetch(VBOData_VerticesNormals &data);
+void optimizeVertexFetch(VBOData_VerticesTexutreCoordsNormals &data);
+
+struct IndexOrderReport {
+  float acmrBefore = 0.f;
+  float acmrAfter = 0.f;
+};
+
+// cache (kept only if it lowers the ACMR), then optionally overdraw, then
+// vertex fetch optimization
+IndexOrderReport optimizeIndexOrder(VBOData_VerticesNormals &data,
+                                    bool sortForOverdraw = true);
+
+// Upload in planar [ vertices | normals | uvs ] storage by default,
+// interleaved storage is there to benchmark against (see vertex_layout.hpp).
+IndexedDraw
+setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                      opengl::BufferObject &indexBuffer,
+                      opengl::BufferObject &vertexBuffer,
+                      opengl::VBOData_Vertices const &data,
+                      VertexStorage storage = VertexStorage::Planar);
+
+IndexedDraw
+setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                      opengl::BufferObject &indexBuffer,
+                      opengl::BufferObject &vertexBuffer,
+                      opengl::VBOData_VerticesNormals const &data,
+                      VertexStorage storage = VertexStorage::Planar);
+
+IndexedDraw
+setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                      opengl::BufferObject &indexBuffer,
+                      opengl::BufferObject &vertexBuffer,
+                      opengl::VBOData_VerticesTexutreCoordsNormals const &data,
+                      VertexStorage storage = VertexStorage::Planar);
+
+// Lets a generator write straight into GPU memory: planar
+// [ vertices | normals ] storage is allocated and mapped, then handed to
+// fill() (a staging copy is used if mapping fails).
+// The indices come from indexBuffers, which only generates and uploads them
+// (as 16-bit indices whenever vertexCount allows) when their topology is new,
+// so a rebuild that only moved vertices uploads nothing else.
+using FillVerticesNormals =
+    std::function<void(math::Vec3f *vertices, math::Vec3f *normals)>;
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices,
+                                  FillVerticesNormals const &fill);
+
+// For a vertex buffer the GPU already filled (see feedback_revolution.hpp):
+// binds the cached indices and points the VAO at vertexCount interleaved
+// LayoutVerticesNormals vertices in vertexBuffer, uploading nothing else.
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices);
+
+// contiguous run of vertices
+struct VertexRange {
+  std::size_t first = 0;
+  std::size_t count = 0;
+};
 
-unsigned int
+// Partial update of a vertex buffer filled by the overload above, with the
+// same vertexCount. ranges are sorted and disjoint. fill writes the vertices
+// of ranges, one range after the other, into arrays staged in scratch that
+// hold only those, and just they are sent with glBufferSubData.
+// Returns the number of bytes uploaded.
+std::size_t update_vertex_ranges(opengl::BufferObject &vertexBuffer,
+                                 std::size_t vertexCount,
+                                 std::vector<VertexRange> const &ranges,
+                                 FillVerticesNormals const &fill,
+                                 memory::FrameArena &scratch);
+
+IndexedDraw
 setup_vao_and_buffers(opengl::VertexArrayObject &vao,
                       opengl::BufferObject &indexBuffer,
                       opengl::BufferObject &vertexBuffer,
-                      opengl::VBOData_VerticesTexutreCoordsNormals const &data);
+                      VBOData_PackedVerticesNormals const &data,
+                      VertexStorage storage = VertexStorage::Planar);
+
+// as above, for packed positions and normals
+using FillPackedVerticesNormals =
+    std::function<void(PackedPosition *vertices, PackedNormal *normals)>;
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices,
+                                  FillPackedVerticesNormals const &fill);
+
+std::size_t update_vertex_ranges(opengl::BufferObject &vertexBuffer,
+                                 std::size_t vertexCount,
+                                 std::vector<VertexRange> const &ranges,
+                                 FillPackedVerticesNormals const &fill,
+                                 memory::FrameArena &scratch);
 
 } // namespace vbo
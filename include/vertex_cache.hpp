@@ -0,0 +1,11 @@
+#pragma once
+
+// Post-transform vertex cache model shared by the index optimizer and the
+// geometry that is laid out for it. Free of GL so geometry code can use it.
+
+namespace opengl {
+
+// post-transform cache size assumed by the optimizer and ACMR simulation
+constexpr unsigned int VERTEX_CACHE_SIZE = 32;
+
+} // namespace opengl
@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "buffer_object.hpp"
+#include "index_buffer.hpp"
+#include "vec2f.hpp"
+#include "vec3f.hpp"
+#include "vertex_array_object.hpp"
+#include "vertex_packing.hpp"
+
+// Compile-time vertex formats
+// A VertexLayout lists the attributes of a vertex, e.g.
+//   using Layout = VertexLayout<Position, Normal, UV>;
+// and from that generates the attribute offsets, the CPU side storage
+// (VertexData<Layout>, which the VBOData_* structs in vbo_tools.hpp are), the
+// packing into one buffer and the attribute setup.
+// Attributes are packed in the order listed, either planar
+//   [ p | p | p | ... | n | n | n | ... | uv | uv | uv ]
+// or interleaved
+//   [ p | n | uv | p | n | uv | ... ]
+
+namespace opengl {
+
+enum class VertexStorage { Planar, Interleaved };
+
+// Describes one attribute: its CPU type and how the shader reads it.
+// Each attribute also names the array VertexData keeps it in, its Array
+// struct, and how to get at it.
+template <typename T, GLuint Location, GLint Components, GLenum Type,
+          GLboolean Normalized>
+struct VertexAttribute {
+  using value_type = T;
+
+  // every attribute offset stays 4 byte aligned in either storage
+  static_assert(sizeof(T) % 4 == 0, "vertex attributes must be 4 byte sized");
+
+  static constexpr GLuint location() { return Location; }
+  static constexpr GLint components() { return Components; }
+  static constexpr GLenum type() { return Type; }
+  static constexpr GLboolean normalized() { return Normalized; }
+};
+
+struct Position : VertexAttribute<math::Vec3f, 0, 3, GL_FLOAT, GL_FALSE> {
+  struct Array {
+    std::vector<value_type> vertices;
+  };
+  static std::vector<value_type> &array(Array &a) { return a.vertices; }
+  static std::vector<value_type> const &array(Array const &a) {
+    return a.vertices;
+  }
+};
+
+struct Normal : VertexAttribute<math::Vec3f, 1, 3, GL_FLOAT, GL_FALSE> {
+  struct Array {
+    std::vector<value_type> normals;
+  };
+  static std::vector<value_type> &array(Array &a) { return a.normals; }
+  static std::vector<value_type> const &array(Array const &a) {
+    return a.normals;
+  }
+};
+
+struct UV : VertexAttribute<math::Vec2f, 2, 2, GL_FLOAT, GL_FALSE> {
+  struct Array {
+    std::vector<value_type> textureCoords;
+  };
+  static std::vector<value_type> &array(Array &a) { return a.textureCoords; }
+  static std::vector<value_type> const &array(Array const &a) {
+    return a.textureCoords;
+  }
+};
+
+// see vertex_packing.hpp, decoded by phong_vs.glsl with PACKED_VERTICES
+struct QuantizedPosition
+    : VertexAttribute<PackedPosition, 0, 3, GL_UNSIGNED_SHORT, GL_TRUE> {
+  struct Array {
+    std::vector<value_type> vertices;
+  };
+  static std::vector<value_type> &array(Array &a) { return a.vertices; }
+  static std::vector<value_type> const &array(Array const &a) {
+    return a.vertices;
+  }
+};
+
+struct OctahedralNormal
+    : VertexAttribute<PackedNormal, 1, 2, GL_SHORT, GL_TRUE> {
+  struct Array {
+    std::vector<value_type> normals;
+  };
+  static std::vector<value_type> &array(Array &a) { return a.normals; }
+  static std::vector<value_type> const &array(Array const &a) {
+    return a.normals;
+  }
+};
+
+namespace layout_detail {
+
+template <std::size_t... I> struct IndexSequence {};
+
+template <std::size_t N, std::size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+
+template <std::size_t... I> struct MakeIndexSequence<0, I...> {
+  using type = IndexSequence<I...>;
+};
+
+// bytes taken by the first N attributes of one vertex
+template <std::size_t N, typename... Attributes> struct PrefixSize {
+  static constexpr std::size_t value = 0;
+};
+
+template <std::size_t N, typename First, typename... Rest>
+struct PrefixSize<N, First, Rest...> {
+  static constexpr std::size_t value =
+      N == 0 ? 0
+             : sizeof(typename First::value_type) +
+                   PrefixSize<(N == 0 ? 0 : N - 1), Rest...>::value;
+};
+
+// position of Attribute in the list
+template <typename Attribute, typename... Attributes> struct IndexOf;
+
+template <typename Attribute, typename... Rest>
+struct IndexOf<Attribute, Attribute, Rest...> {
+  static constexpr std::size_t value = 0;
+};
+
+template <typename Attribute, typename First, typename... Rest>
+struct IndexOf<Attribute, First, Rest...> {
+  static constexpr std::size_t value = 1 + IndexOf<Attribute, Rest...>::value;
+};
+
+} // namespace layout_detail
+
+template <typename... Attributes> struct VertexLayout {
+  static_assert(sizeof...(Attributes) > 0, "a vertex needs an attribute");
+
+  static constexpr std::size_t attributeCount = sizeof...(Attributes);
+
+  // bytes per vertex, the stride of interleaved storage
+  static constexpr std::size_t vertexSize() {
+    return layout_detail::PrefixSize<attributeCount, Attributes...>::value;
+  }
+
+  // offset within an interleaved vertex
+  // (planar storage starts the attribute at vertexCount * offsetOf)
+  template <typename Attribute> static constexpr std::size_t offsetOf() {
+    return layout_detail::PrefixSize<
+        layout_detail::IndexOf<Attribute, Attributes...>::value,
+        Attributes...>::value;
+  }
+
+  // one array per attribute, each vertexCount long
+  using Sources = std::tuple<typename Attributes::value_type const *...>;
+
+  // writes vertexCount vertices, vertexSize() * vertexCount bytes, to out
+  static void pack(Sources const &sources, std::size_t vertexCount,
+                   VertexStorage storage, char *out);
+
+  // points every attribute into the bound GL_ARRAY_BUFFER
+  static void setupAttributes(std::size_t vertexCount, VertexStorage storage);
+};
+
+// CPU side mesh in the layout's format: the indices plus one array per
+// attribute, each a member named by the attribute (vertices, normals,
+// textureCoords), so e.g. VertexData<VertexLayout<Position, Normal>> has
+// indices, vertices and normals.
+template <typename Layout> struct VertexData;
+
+template <typename... Attributes>
+struct VertexData<VertexLayout<Attributes...>> : Attributes::Array... {
+  using Layout = VertexLayout<Attributes...>;
+
+  VertexData() = default;
+
+  // the arrays in the layout's order
+  VertexData(std::vector<unsigned int> indices,
+             std::vector<typename Attributes::value_type>... arrays);
+
+  std::vector<unsigned int> indices;
+
+  template <typename Attribute>
+  std::vector<typename Attribute::value_type> &get();
+
+  template <typename Attribute>
+  std::vector<typename Attribute::value_type> const &get() const;
+
+  std::size_t vertexCount() const;
+
+  typename Layout::Sources sources() const;
+};
+
+// Uploads indices and vertices and sets up the VAO.
+// Returns the triangle list draw, with 16-bit indices when they fit.
+template <typename Layout>
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::vector<unsigned int> const &indices,
+                                  std::size_t vertexCount,
+                                  typename Layout::Sources const &sources,
+                                  VertexStorage storage);
+
+template <typename Layout>
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  VertexData<Layout> const &data,
+                                  VertexStorage storage);
+
+} // namespace opengl
+
+#include "vertex_layout.tpp"
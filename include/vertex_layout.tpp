@@ -0,0 +1,189 @@
+#include "vertex_layout.hpp"
+
+#include "trace.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace opengl {
+
+namespace layout_detail {
+
+// Offset is the attribute's offset within one vertex
+template <typename Attribute, std::size_t Offset, std::size_t Stride>
+void packAttribute(typename Attribute::value_type const *source,
+                   std::size_t vertexCount, VertexStorage storage, char *out) {
+  constexpr std::size_t size = sizeof(typename Attribute::value_type);
+
+  if (storage == VertexStorage::Planar) {
+    std::memcpy(out + vertexCount * Offset, source, vertexCount * size);
+    return;
+  }
+
+  out += Offset;
+  for (std::size_t v = 0; v < vertexCount; ++v, out += Stride) {
+    std::memcpy(out, source + v, size);
+  }
+}
+
+template <typename Attribute, std::size_t Offset, std::size_t Stride>
+void setupAttribute(std::size_t vertexCount, VertexStorage storage) {
+  constexpr std::size_t size = sizeof(typename Attribute::value_type);
+
+  bool planar = storage == VertexStorage::Planar;
+  std::size_t offset = planar ? vertexCount * Offset : Offset;
+
+  glEnableVertexAttribArray(Attribute::location()); // match layout # in shader
+  glVertexAttribPointer(                            //
+      Attribute::location(),                        // attribute layout #
+      Attribute::components(),                      // coordinates per vertex
+      Attribute::type(),                            // type
+      Attribute::normalized(),                      // normalized?
+      planar ? size : Stride,                       // stride
+      (void *)(offset)                              // array buffer offset
+      );
+}
+
+template <typename... Attributes, std::size_t... I>
+void packAll(IndexSequence<I...>,
+             std::tuple<typename Attributes::value_type const *...> const
+                 &sources,
+             std::size_t vertexCount, VertexStorage storage, char *out) {
+  constexpr std::size_t stride =
+      PrefixSize<sizeof...(Attributes), Attributes...>::value;
+
+  int expand[] = {0, (packAttribute<Attributes,
+                                    PrefixSize<I, Attributes...>::value,
+                                    stride>(std::get<I>(sources), vertexCount,
+                                            storage, out),
+                      0)...};
+  (void)expand;
+}
+
+template <typename... Attributes, std::size_t... I>
+void setupAll(IndexSequence<I...>, std::size_t vertexCount,
+              VertexStorage storage) {
+  constexpr std::size_t stride =
+      PrefixSize<sizeof...(Attributes), Attributes...>::value;
+
+  int expand[] = {0, (setupAttribute<Attributes,
+                                     PrefixSize<I, Attributes...>::value,
+                                     stride>(vertexCount, storage),
+                      0)...};
+  (void)expand;
+}
+
+} // namespace layout_detail
+
+template <typename... Attributes>
+void VertexLayout<Attributes...>::pack(Sources const &sources,
+                                       std::size_t vertexCount,
+                                       VertexStorage storage, char *out) {
+  layout_detail::packAll<Attributes...>(
+      typename layout_detail::MakeIndexSequence<attributeCount>::type(),
+      sources, vertexCount, storage, out);
+}
+
+template <typename... Attributes>
+void VertexLayout<Attributes...>::setupAttributes(std::size_t vertexCount,
+                                                  VertexStorage storage) {
+  layout_detail::setupAll<Attributes...>(
+      typename layout_detail::MakeIndexSequence<attributeCount>::type(),
+      vertexCount, storage);
+}
+
+template <typename... Attributes>
+VertexData<VertexLayout<Attributes...>>::VertexData(
+    std::vector<unsigned int> indices,
+    std::vector<typename Attributes::value_type>... arrays)
+    : Attributes::Array{std::move(arrays)}..., indices(std::move(indices)) {}
+
+template <typename... Attributes>
+template <typename Attribute>
+std::vector<typename Attribute::value_type> &
+VertexData<VertexLayout<Attributes...>>::get() {
+  return Attribute::array(*this);
+}
+
+template <typename... Attributes>
+template <typename Attribute>
+std::vector<typename Attribute::value_type> const &
+VertexData<VertexLayout<Attributes...>>::get() const {
+  return Attribute::array(*this);
+}
+
+template <typename... Attributes>
+std::size_t VertexData<VertexLayout<Attributes...>>::vertexCount() const {
+  using First = typename std::tuple_element<0, std::tuple<Attributes...>>::type;
+  return get<First>().size();
+}
+
+template <typename... Attributes>
+typename VertexLayout<Attributes...>::Sources
+VertexData<VertexLayout<Attributes...>>::sources() const {
+  return typename Layout::Sources(get<Attributes>().data()...);
+}
+
+template <typename Layout>
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::vector<unsigned int> const &indices,
+                                  std::size_t vertexCount,
+                                  typename Layout::Sources const &sources,
+                                  VertexStorage storage) {
+  profiling::TraceScope trace("vbo", "setup_vao_and_buffers");
+
+  vao.bind();
+
+  // bind these indices
+  indexBuffer.bind(BufferObject::ELEMENT_ARRAY);
+  auto draw = uploadIndices(indices, vertexCount);
+
+  auto totalSize = Layout::vertexSize() * vertexCount;
+
+  vertexBuffer.bind(BufferObject::ARRAY);
+  Layout::setupAttributes(vertexCount, storage);
+
+  profiling::TraceScope uploadTrace("upload", "vertex upload");
+
+  // request storage, but provide no data
+  glBufferData(GL_ARRAY_BUFFER, totalSize, NULL, GL_STATIC_DRAW);
+
+  if (totalSize > 0) {
+    // pack straight into the buffer, the old contents are invalidated so
+    // mapping never waits on a previous draw
+    auto *vertexData = static_cast<char *>(
+        glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize,
+                         GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+    if (vertexData) {
+      Layout::pack(sources, vertexCount, storage, vertexData);
+    }
+
+    if (!vertexData || glUnmapBuffer(GL_ARRAY_BUFFER) != GL_TRUE) {
+      std::vector<char> staging(totalSize);
+      Layout::pack(sources, vertexCount, storage, staging.data());
+      glBufferSubData(GL_ARRAY_BUFFER, 0, totalSize, staging.data());
+    }
+  }
+
+  vao.unbind();
+  indexBuffer.unbind();
+  vertexBuffer.unbind();
+
+  return draw;
+}
+
+template <typename Layout>
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  VertexData<Layout> const &data,
+                                  VertexStorage storage) {
+  return setup_vao_and_buffers<Layout>(vao, indexBuffer, vertexBuffer,
+                                       data.indices, data.vertexCount(),
+                                       data.sources(), storage);
+}
+
+} // namespace opengl
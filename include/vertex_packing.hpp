@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "obj_mesh.hpp"
+#include "vec3f.hpp"
+
+// Compressed vertex attributes
+// positions: 3 x unorm16 relative to the mesh bounds (plus padding, 8 bytes)
+// normals:   octahedral encoding in 2 x snorm16 (4 bytes)
+// vs. 24 bytes for float positions and normals
+
+namespace opengl {
+
+struct PackedPosition {
+  std::uint16_t x;
+  std::uint16_t y;
+  std::uint16_t z;
+  std::uint16_t pad; // keeps every position 8 byte aligned
+};
+
+struct PackedNormal {
+  std::int16_t x;
+  std::int16_t y;
+};
+
+// decoded position = offset + scale * (unorm16 / 65535)
+struct PositionQuantization {
+  math::Vec3f offset;
+  math::Vec3f scale = math::Vec3f(1.f, 1.f, 1.f);
+};
+
+bool operator==(PositionQuantization const &lhs,
+                PositionQuantization const &rhs);
+bool operator!=(PositionQuantization const &lhs,
+                PositionQuantization const &rhs);
+
+PositionQuantization quantizationForBounds(math::Vec3f const &boundsMin,
+                                           math::Vec3f const &boundsMax);
+
+PositionQuantization quantizationFor(geometry::Vertices const &vertices);
+
+PackedPosition packPosition(math::Vec3f const &position,
+                            PositionQuantization const &quantization);
+
+PackedNormal packNormal(math::Vec3f const &normal);
+
+// CPU reference of the shader decode
+math::Vec3f unpackPosition(PackedPosition const &position,
+                           PositionQuantization const &quantization);
+
+math::Vec3f unpackNormal(PackedNormal const &normal);
+
+} // namespace opengl
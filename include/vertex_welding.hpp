@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+
+#include "obj_mesh.hpp"
+
+namespace geometry {
+
+// Merges vertices that lie within epsilon of an earlier vertex (epsilon > 0).
+// Vertices are bucketed in a uniform grid of epsilon sized cells, so each
+// vertex is only compared against the 27 cells around it and the pass is
+// linear in the number of vertices. The vertex array is compacted in place
+// (first occurrence order), triangle vertex IDs are remapped and triangles
+// that collapse onto fewer than 3 vertices are dropped. Texture coordinate
+// and normal IDs are left untouched. Returns the number of unique vertices.
+std::size_t weldVertices(OBJMesh &mesh, float epsilon);
+
+} // namespace geometry
@@ -0,0 +1,15 @@
+#version 330 core
+//One Chaikin level, captured with transform feedback (nothing is drawn).
+//Instance i is the segment (p[i], p[i+1]), its two vertices the points at
+//1/4 and 3/4, so the capture holds the next level in order.
+layout (location = 0) in vec3 segmentStart;
+layout (location = 1) in vec3 segmentEnd;
+
+out vec3 point;
+
+void main()
+{
+    float t = gl_VertexID == 0 ? 0.25 : 0.75;
+    //same form as math::lerp
+    point = (1.0 - t) * segmentStart + t * segmentEnd;
+}
@@ -1,4 +1,11 @@
 #version 330 core
+//Permutations, selected by the #defines opengl::ProgramVariants injects:
+//  FLAT_SHADING  one normal per triangle, from screen space derivatives
+//  LIGHT_COUNT   number of point lights in lightPosition, 1 if not defined
+#if !defined(LIGHT_COUNT)
+#define LIGHT_COUNT 1
+#endif
+
 out vec4 fragColor;
 
 in Data
@@ -7,32 +14,45 @@ in Data
     vec3 norm;
 } data;
 
-uniform vec3 lightPosition;
+uniform vec3 lightPosition[LIGHT_COUNT];
 uniform vec3 viewPosition;
 uniform vec3 lightColour = vec3(1.0, 1.0, 1.0);
 
 
 void main()
 {
+#if defined(FLAT_SHADING)
+    //the derivatives span the triangle as seen on screen, so this faces the
+    //viewer on either side of a double-sided surface
+    vec3 normal = normalize(cross(dFdx(data.position), dFdy(data.position)));
+#else
+    //open surfaces are drawn double-sided, their inside faces the other way
+    vec3 normal = normalize(gl_FrontFacing ? data.norm : -data.norm);
+#endif
+
     //gouraud uses ambient or only the highlight can be seen
     float ambientLight = 0.2;
     vec3 ambient = ambientLight * lightColour;
 
-    //find the light direction
-
     float diffuseStrength = 0.3;
-    vec3 lightDirection = normalize(data.position - lightPosition);
-    float diff = max(dot(normalize(data.norm), lightDirection), 0.0); //dot prod
-    vec3 diffuse = (diff * diffuseStrength) * lightColour;
-
-
-    //specular
     float specularLight = 0.5;
     vec3 viewVec = normalize(data.position - (-viewPosition));
-    vec3 reflectionVec = reflect(lightDirection, normalize(data.norm));
 
-    float specAmt = pow(max(dot(reflectionVec, viewVec), 0.0), 32);
-    vec3 specular = specularLight * specAmt * lightColour;
+    vec3 diffuse = vec3(0.0);
+    vec3 specular = vec3(0.0);
+    for (int i = 0; i < LIGHT_COUNT; ++i)
+    {
+        //find the light direction
+        vec3 lightDirection = normalize(data.position - lightPosition[i]);
+        //normals point outward, lit from the side facing the light
+        float diff = max(dot(normal, -lightDirection), 0.0); //dot prod
+        diffuse += (diff * diffuseStrength) * lightColour;
+
+        //specular
+        vec3 reflectionVec = reflect(lightDirection, normal);
+        float specAmt = pow(max(dot(reflectionVec, viewVec), 0.0), 32);
+        specular += specularLight * specAmt * lightColour;
+    }
 
     vec3 result = (ambient + diffuse + specular);
 
@@ -1,6 +1,35 @@
 #version 330 core
+//Permutations, selected by the #defines opengl::ProgramVariants injects:
+//  (none)            float positions and normals
+//  PACKED_VERTICES   unorm16 positions and octahedral snorm16 normals
+//  REVOLVED_PROFILE  no vertex attributes, the revolved grid is generated from
+//                    the subdivided profile, one instance per triangle strip
+//                    between neighbouring slices, with analytic normals
+//  FLAT_SHADING      normals are not needed, the fragment shader derives them
+
+#if defined(REVOLVED_PROFILE)
+//profile points, one float per texel, x y z
+uniform samplerBuffer profile;
+
+//+1 or -1, geometry::revolutionSweep(), keeps the surface facing outward
+uniform float sweep = 1.0;
+
+//geometry::REVOLUTION_SLICES
+const int SLICES = 72;
+const float STEP = 6.28318530718 / float(SLICES);
+#elif defined(PACKED_VERTICES)
+//unorm16 positions, normalized by the attribute setup to [0, 1]
+layout (location = 0) in vec3 position;
+//octahedral snorm16 normals, normalized to [-1, 1]
+layout (location = 1) in vec2 normal;
+
+//mesh bounds the positions were quantized against
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+#else
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
+#endif
 
 out Data
 {
@@ -12,10 +41,92 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+#if defined(REVOLVED_PROFILE)
+vec3 profilePoint(int i)
+{
+    return vec3(texelFetch(profile, 3 * i).r,
+                texelFetch(profile, 3 * i + 1).r,
+                texelFetch(profile, 3 * i + 2).r);
+}
+
+//rotation about the y axis, as math::rotateAroundAxis
+vec3 rotateY(vec3 v, float c, float s)
+{
+    return vec3(v.x * c + v.z * s, v.y, v.z * c - v.x * s);
+}
+
+void modelSpace(out vec3 modelPosition, out vec3 modelNormal)
+{
+    int count = textureSize(profile) / 3;
+    int j = gl_VertexID / 2;
+    //the last strip wraps around to slice 0 exactly, leaving no seam
+    int slice = (gl_InstanceID + 1 - gl_VertexID % 2) % SLICES;
+
+    float angle = sweep * float(slice) * STEP;
+    float c = cos(angle);
+    float s = sin(angle);
+
+    vec3 point = profilePoint(j);
+    modelPosition = rotateY(point, c, s);
+
+#if defined(FLAT_SHADING)
+    modelNormal = vec3(0.0);
+#else
+    //analytic normal of the surface of revolution: the profile tangent turned
+    //a quarter away from the axis, central differences clamped at the ends
+    vec3 tangent = profilePoint(min(j + 1, count - 1)) - profilePoint(max(j - 1, 0));
+    float side = point.x < 0.0 ? -sweep : sweep;
+    vec3 n = vec3(-tangent.y * side, tangent.x * side, 0.0);
+    float len = length(n);
+    if (len > 0.0)
+        n /= len;
+    modelNormal = rotateY(n, c, s);
+#endif
+}
+#elif defined(PACKED_VERTICES)
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    //lower hemisphere was folded over the diagonals
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * signNotZero(n.xy);
+    return normalize(n);
+}
+
+void modelSpace(out vec3 modelPosition, out vec3 modelNormal)
+{
+    modelPosition = positionOffset + positionScale * position;
+#if defined(FLAT_SHADING)
+    modelNormal = vec3(0.0);
+#else
+    modelNormal = octahedralDecode(normal);
+#endif
+}
+#else
+void modelSpace(out vec3 modelPosition, out vec3 modelNormal)
+{
+    modelPosition = position;
+    modelNormal = normal;
+}
+#endif
+
 void main()
 {
+    vec3 modelPosition;
+    vec3 modelNormal;
+    modelSpace(modelPosition, modelNormal);
+
 	//move vertices in model space to world space
-    data.position = vec3(model * vec4(position, 1.0));
-    data.norm = mat3(transpose(inverse(model))) * normal;
+    data.position = vec3(model * vec4(modelPosition, 1.0));
+#if defined(FLAT_SHADING)
+    data.norm = vec3(0.0);
+#else
+    data.norm = mat3(transpose(inverse(model))) * modelNormal;
+#endif
     gl_Position = projection * view * vec4(data.position, 1.0);
 }
@@ -0,0 +1,42 @@
+#version 330 core
+//Revolution pass, captured with transform feedback (nothing is drawn).
+//Instance s sweeps the profile to slice s, so the capture is the revolved
+//grid in its usual order, vertex (slice, j) at slice * profileSize + j.
+//previous/next are the neighbouring profile points, the profile buffer
+//repeats its end points so they clamp at the ends.
+layout (location = 0) in vec3 previous;
+layout (location = 1) in vec3 point;
+layout (location = 2) in vec3 next;
+
+out vec3 position;
+out vec3 normal;
+
+//cos and sin of every slice angle, the CPU's table
+//(geometry::REVOLUTION_SLICES)
+uniform vec2 sliceRotation[72];
+
+//+1 or -1, geometry::revolutionSweep(), keeps the surface facing outward
+uniform float sweep;
+
+//rotation about the y axis, as math::rotateAroundAxis
+vec3 rotateY(vec3 v, vec2 r)
+{
+    return vec3(v.x * r.x + v.z * r.y, v.y, v.z * r.x - v.x * r.y);
+}
+
+void main()
+{
+    //the profile tangent turned a quarter away from the axis, see
+    //geometry::revolution_detail::profileNormal
+    vec3 tangent = next - previous;
+    float side = point.x < 0.0 ? -sweep : sweep;
+    vec3 n = vec3(-tangent.y * side, tangent.x * side, 0.0);
+    float len = length(n);
+    if (len > 0.0)
+        n /= len;
+
+    //the other sweep direction mirrors the angle
+    vec2 r = sliceRotation[gl_InstanceID] * vec2(1.0, sweep);
+    position = rotateY(point, r);
+    normal = rotateY(n, r);
+}
@@ -0,0 +1,43 @@
+#include "allocation_counter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace memory {
+
+namespace {
+std::atomic<std::size_t> g_heapAllocations(0);
+} // namespace
+
+bool heapAllocationCountingEnabled() {
+#ifdef CURVES_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+std::size_t heapAllocationCount() {
+  return g_heapAllocations.load(std::memory_order_relaxed);
+}
+
+} // namespace memory
+
+#ifdef CURVES_COUNT_ALLOCATIONS
+
+void *operator new(std::size_t size) {
+  memory::g_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+#endif
@@ -1,7 +1,11 @@
 #include "buffer_object.hpp"
 
 #include <cassert>
+#include <iostream>
 #include <utility>
+#include <vector>
+
+#include "trace.hpp"
 
 namespace opengl {
 
@@ -66,6 +70,32 @@ BufferObject::Type enumToBufferObjectType(GLenum bufferObjectEnum) {
   }
 }
 
+void fillBufferMapped(GLenum target, std::size_t bytes, GLenum usage,
+                      std::function<void(void *data)> const &fill) {
+  profiling::TraceScope trace("upload", "fillBufferMapped");
+
+  // request storage, but provide no data
+  glBufferData(target, bytes, NULL, usage);
+
+  if (bytes == 0) {
+    return;
+  }
+
+  auto *data = glMapBufferRange(target, 0, bytes,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  if (data) {
+    fill(data);
+  }
+
+  if (!data || glUnmapBuffer(target) != GL_TRUE) {
+    std::cerr << "[Log] buffer mapping failed, uploading through CPU\n";
+
+    std::vector<char> staging(bytes);
+    fill(staging.data());
+    glBufferSubData(target, 0, bytes, staging.data());
+  }
+}
+
 template <> void release_object<BufferObject>(GLuint &name) {
   glDeleteBuffers(1, &name);
 }
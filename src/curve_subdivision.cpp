@@ -0,0 +1,277 @@
+#include "curve_subdivision.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "trace.hpp"
+
+namespace geometry {
+
+namespace {
+
+// output points per block, two ping-pong levels of this stay inside L2
+constexpr std::size_t BLOCK_SIZE = 8192;
+
+// one Chaikin level, out must hold 2 * (count - 1) points
+void chaikinLevel(math::Vec3f const *in, std::size_t count, math::Vec3f *out) {
+  for (std::size_t i = 0; i + 1 < count; ++i) {
+    out[2 * i] = math::lerp(in[i], in[i + 1], 0.25f);
+    out[2 * i + 1] = math::lerp(in[i], in[i + 1], 0.75f);
+  }
+}
+
+std::size_t nextLevelSize(std::size_t count) {
+  return count < 2 ? 0 : 2 * (count - 1);
+}
+
+} // namespace
+
+SubdivisionScratch::SubdivisionScratch(memory::FrameArena &arena)
+    : current(memory::ArenaAllocator<math::Vec3f>(arena)),
+      next(memory::ArenaAllocator<math::Vec3f>(arena)),
+      first(memory::ArenaAllocator<std::size_t>(arena)),
+      last(memory::ArenaAllocator<std::size_t>(arena)) {}
+
+std::size_t subdividedOpenCurveSize(std::size_t count, int depth) {
+  for (int d = 0; d < depth; ++d) {
+    count = nextLevelSize(count);
+  }
+  return count;
+}
+
+Vertices subdivideOpenCurve(Vertices const &points, int depth) {
+  auto finalSize = subdividedOpenCurveSize(points.size(), depth);
+
+  // ping-pong between two buffers that never reallocate
+  Vertices current;
+  Vertices next;
+  current.reserve(std::max(finalSize, points.size()));
+  next.reserve(finalSize);
+  current.assign(points.begin(), points.end());
+
+  for (int d = 0; d < depth; ++d) {
+    next.resize(nextLevelSize(current.size()));
+    chaikinLevel(current.data(), current.size(), next.data());
+    std::swap(current, next);
+  }
+
+  return current;
+}
+
+void subdivideOpenCurve(Vertices const &points, int depth, Vertices &out,
+                        SubdivisionScratch &scratch) {
+  if (depth <= 0) {
+    out.assign(points.begin(), points.end());
+    return;
+  }
+
+  // the level before last is the largest that goes to scratch
+  out.reserve(subdividedOpenCurveSize(points.size(), depth));
+  scratch.next.reserve(subdividedOpenCurveSize(points.size(), depth - 1));
+
+  // levels alternate between out and scratch, starting so the last one
+  // lands in out
+  math::Vec3f const *in = points.data();
+  std::size_t count = points.size();
+  for (int d = 0; d < depth; ++d) {
+    auto nextCount = nextLevelSize(count);
+    math::Vec3f *level;
+    if ((depth - 1 - d) % 2 == 0) {
+      out.resize(nextCount);
+      level = out.data();
+    } else {
+      scratch.next.resize(nextCount);
+      level = scratch.next.data();
+    }
+
+    chaikinLevel(in, count, level);
+    in = level;
+    count = nextCount;
+  }
+}
+
+double controlPolygonParameter(double index, int depth) {
+  // point 2i of a level is at 1/4 and 2i + 1 at 3/4 of parent segment i, so
+  // each level halves the spacing and shifts the start by a quarter of the
+  // parent's spacing
+  double scale = std::ldexp(1.0, -depth);
+  return index * scale + 0.5 * (1.0 - scale);
+}
+
+void subdividedRangeAffectedBy(std::size_t count, int depth, std::size_t &first,
+                               std::size_t &last) {
+  // input point j feeds outputs 2j - 2 .. 2j + 1 (segments j - 1 and j)
+  for (int d = 0; d < depth; ++d) {
+    count = nextLevelSize(count);
+    first = first > 0 ? 2 * first - 2 : 0;
+    last = std::min(2 * last, count);
+  }
+  first = std::min(first, last);
+}
+
+void subdivideOpenCurveRange(Vertices const &points, int depth,
+                             std::size_t first, std::size_t last,
+                             math::Vec3f *out, SubdivisionScratch &scratch) {
+  if (first >= last) {
+    return;
+  }
+
+  scratch.first.resize(depth + 1);
+  scratch.last.resize(depth + 1);
+  scratch.first[depth] = first;
+  scratch.last[depth] = last;
+
+  // walk back to the input range this block depends on
+  // output point k at level d comes from points k/2 and k/2 + 1 at d - 1
+  for (int d = depth; d > 0; --d) {
+    scratch.first[d - 1] = scratch.first[d] / 2;
+    scratch.last[d - 1] =
+        std::min((scratch.last[d] - 1) / 2 + 2,
+                 subdividedOpenCurveSize(points.size(), d - 1));
+  }
+
+  scratch.current.assign(points.begin() + scratch.first[0],
+                         points.begin() + scratch.last[0]);
+  for (int d = 0; d < depth; ++d) {
+    scratch.next.resize(nextLevelSize(scratch.current.size()));
+    chaikinLevel(scratch.current.data(), scratch.current.size(),
+                 scratch.next.data());
+    std::swap(scratch.current, scratch.next);
+  }
+
+  // local results start at global index first[0] * 2^depth
+  auto offset = (scratch.first[0] << depth);
+  std::copy(scratch.current.begin() + (first - offset),
+            scratch.current.begin() + (last - offset), out);
+}
+
+SubdivisionWorkers::SubdivisionWorkers(unsigned int threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  for (unsigned int t = 0; t < threadCount; ++t) {
+    m_arenas.emplace_back(
+        new memory::FrameArena(4 * BLOCK_SIZE * sizeof(math::Vec3f)));
+  }
+
+  m_threads.reserve(threadCount - 1);
+  for (unsigned int t = 0; t + 1 < threadCount; ++t) {
+    m_threads.emplace_back(&SubdivisionWorkers::workerLoop, this, t);
+  }
+}
+
+SubdivisionWorkers::~SubdivisionWorkers() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_started.notify_all();
+
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+unsigned int SubdivisionWorkers::threadCount() const {
+  return unsigned(m_arenas.size());
+}
+
+void SubdivisionWorkers::runBlocks(std::size_t worker) {
+  profiling::TraceScope trace("mesh", "subdivision worker");
+
+  // the previous job's scratch is gone, its storage is reused
+  auto &arena = *m_arenas[worker];
+  arena.reset();
+  SubdivisionScratch scratch(arena);
+
+  for (std::size_t block = m_job.nextBlock++; block < m_job.blockCount;
+       block = m_job.nextBlock++) {
+    auto first = block * BLOCK_SIZE;
+    auto last = std::min(first + BLOCK_SIZE, m_job.outSize);
+    subdivideOpenCurveRange(*m_job.points, m_job.depth, first, last,
+                            m_job.out + first, scratch);
+  }
+}
+
+void SubdivisionWorkers::workerLoop(std::size_t worker) {
+  profiling::setTraceThreadName("subdivision worker");
+
+  std::size_t generation = 0;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (true) {
+    m_started.wait(lock,
+                   [&]() { return m_stop || m_generation != generation; });
+    if (m_stop) {
+      return;
+    }
+    generation = m_generation;
+
+    lock.unlock();
+    runBlocks(worker);
+    lock.lock();
+
+    if (--m_running == 0) {
+      m_finished.notify_one();
+    }
+  }
+}
+
+void subdivideOpenCurveParallel(Vertices const &points, int depth,
+                                SubdivisionWorkers &workers, Vertices &out) {
+  if (depth <= 0 || points.size() < 2) {
+    // nothing to split, the caller's arena is free between jobs
+    auto &arena = *workers.m_arenas.back();
+    arena.reset();
+    SubdivisionScratch scratch(arena);
+    subdivideOpenCurve(points, depth, out, scratch);
+    return;
+  }
+
+  out.resize(subdividedOpenCurveSize(points.size(), depth));
+
+  auto &job = workers.m_job;
+  job.points = &points;
+  job.depth = depth;
+  job.out = out.data();
+  job.outSize = out.size();
+  job.blockCount = (out.size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  job.nextBlock = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(workers.m_mutex);
+    workers.m_running = workers.m_threads.size();
+    ++workers.m_generation;
+  }
+  workers.m_started.notify_all();
+
+  // calling thread takes a share too
+  workers.runBlocks(workers.m_arenas.size() - 1);
+
+  std::unique_lock<std::mutex> lock(workers.m_mutex);
+  workers.m_finished.wait(lock, [&]() { return workers.m_running == 0; });
+}
+
+Vertices subdivideOpenCurveParallel(Vertices const &points, int depth,
+                                    unsigned int threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // no more threads than blocks
+  std::size_t blockCount =
+      (subdividedOpenCurveSize(points.size(), depth) + BLOCK_SIZE - 1) /
+      BLOCK_SIZE;
+  threadCount = unsigned(
+      std::max<std::size_t>(1, std::min<std::size_t>(threadCount, blockCount)));
+
+  SubdivisionWorkers workers(threadCount);
+  Vertices out;
+  subdivideOpenCurveParallel(points, depth, workers, out);
+  return out;
+}
+
+} // namespace geometry
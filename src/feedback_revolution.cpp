@@ -0,0 +1,200 @@
+#include "feedback_revolution.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "curve_subdivision.hpp"
+#include "surface_of_revolution.hpp"
+
+namespace opengl {
+
+FeedbackRevolution::FeedbackRevolution(Program chaikin, Program revolution)
+    : m_chaikin(std::move(chaikin)), m_revolution(std::move(revolution)),
+      m_vao(makeVertexArrayObject()),
+      m_levels{makeBufferObject(), makeBufferObject()} {}
+
+bool FeedbackRevolution::isValid() const {
+  return m_chaikin.isValid() && m_revolution.isValid();
+}
+
+FeedbackRevolution::operator bool() const { return isValid(); }
+
+void FeedbackRevolution::pointAttribute(GLuint location, std::size_t offset,
+                                        GLuint divisor) {
+  glEnableVertexAttribArray(location); // match layout # in shader
+  glVertexAttribPointer(                //
+      location,                         // attribute layout #
+      3,                                // coordinates per vertex
+      GL_FLOAT,                         // type
+      GL_FALSE,                         // normalized?
+      sizeof(math::Vec3f),              // stride
+      (void *)(offset)                  // array buffer offset
+      );
+  glVertexAttribDivisor(location, divisor);
+}
+
+std::size_t FeedbackRevolution::revolve(geometry::Vertices const &controlPoints,
+                                        int depth,
+                                        BufferObject &vertexBuffer,
+                                        memory::FrameArena &arena) {
+  constexpr std::size_t pointSize = sizeof(math::Vec3f);
+
+  auto profileSize =
+      geometry::subdividedOpenCurveSize(controlPoints.size(), depth);
+  if (!isValid() || controlPoints.size() < 2 || profileSize < 2) {
+    return 0;
+  }
+
+  m_vao.bind();
+  glEnable(GL_RASTERIZER_DISCARD);
+
+  // levels only grow, so the largest is the last (or the control points)
+  auto levelBytes =
+      (std::max(profileSize, controlPoints.size()) + 2) * pointSize;
+  if (levelBytes > m_levelCapacity) {
+    for (auto &level : m_levels) {
+      level.bind(BufferObject::ARRAY);
+      glBufferData(GL_ARRAY_BUFFER, levelBytes, NULL, GL_DYNAMIC_COPY);
+    }
+    m_levelCapacity = levelBytes;
+  }
+
+  m_levels[0].bind(BufferObject::ARRAY);
+  glBufferSubData(GL_ARRAY_BUFFER, pointSize,
+                  controlPoints.size() * pointSize, controlPoints.data());
+
+  // Chaikin levels: segment i of the current level is instance i, reading
+  // p[i] and p[i + 1] as per-instance attributes
+  m_chaikin.use();
+  std::size_t count = controlPoints.size();
+  int current = 0;
+  for (int d = 0; d < depth; ++d) {
+    auto next = 2 * (count - 1);
+
+    m_levels[current].bind(BufferObject::ARRAY);
+    pointAttribute(0, pointSize, 1);
+    pointAttribute(1, 2 * pointSize, 1);
+    glDisableVertexAttribArray(2);
+
+    glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0,
+                      m_levels[1 - current].id(), pointSize, next * pointSize);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArraysInstanced(GL_POINTS, 0, 2, count - 1);
+    glEndTransformFeedback();
+
+    count = next;
+    current = 1 - current;
+  }
+
+  // repeat the end points around the profile, so the revolution pass's
+  // neighbours clamp like the CPU's central differences
+  auto profile = m_levels[current].id();
+  glBindBuffer(GL_COPY_READ_BUFFER, profile);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, profile);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, pointSize, 0,
+                      pointSize);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                      profileSize * pointSize, (profileSize + 1) * pointSize,
+                      pointSize);
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  // revolution: instance s writes slice s of the grid
+  auto vertexCount = geometry::revolvedGridVertexCount(profileSize);
+  // other pipelines fill the same buffer, so its size is asked for rather
+  // than remembered; storage of the right size is captured over in place
+  auto vertexBytes = GLint(2 * pointSize * vertexCount);
+  GLint bufferBytes = 0;
+  vertexBuffer.bind(BufferObject::ARRAY);
+  glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &bufferBytes);
+  if (bufferBytes != vertexBytes) {
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, NULL, GL_DYNAMIC_COPY);
+  }
+
+  m_revolution.use();
+  glUniform1f(m_revolution.uniformLocation("sweep"),
+              geometry::revolutionSweep(controlPoints, depth, arena));
+  m_levels[current].bind(BufferObject::ARRAY);
+  pointAttribute(0, 0, 0);
+  pointAttribute(1, pointSize, 0);
+  pointAttribute(2, 2 * pointSize, 0);
+
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, vertexBuffer.id());
+  glBeginTransformFeedback(GL_POINTS);
+  glDrawArraysInstanced(GL_POINTS, 0, profileSize,
+                        geometry::REVOLUTION_SLICES);
+  glEndTransformFeedback();
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+
+  glDisable(GL_RASTERIZER_DISCARD);
+  m_vao.unbind();
+  m_levels[current].unbind();
+
+  return profileSize;
+}
+
+FeedbackRevolution
+makeFeedbackRevolution(std::string const &chaikinShaderSource,
+                       std::string const &revolutionShaderSource) {
+  FeedbackRevolution pipeline(
+      makeTransformFeedbackProgram(chaikinShaderSource, {"point"}),
+      makeTransformFeedbackProgram(revolutionShaderSource,
+                                   {"position", "normal"}));
+
+  if (pipeline) {
+    // the same rotations as the CPU grid, so both can be compared closely,
+    // revolve() mirrors them for the other sweep direction
+    auto const rotations = geometry::revolution_detail::sliceRotations(1.f);
+    std::vector<GLfloat> cosSin;
+    cosSin.reserve(2 * rotations.size());
+    for (auto const &rotation : rotations) {
+      cosSin.push_back(rotation.cosTheta);
+      cosSin.push_back(rotation.sinTheta);
+    }
+
+    pipeline.m_revolution.use();
+    glUniform2fv(pipeline.m_revolution.uniformLocation("sliceRotation"),
+                 GLsizei(rotations.size()), cosSin.data());
+  }
+
+  return pipeline;
+}
+
+FeedbackComparison compareWithCPU(geometry::Vertices const &controlPoints,
+                                  int depth, BufferObject &vertexBuffer,
+                                  memory::FrameArena &arena) {
+  FeedbackComparison comparison;
+
+  auto profileSize =
+      geometry::subdividedOpenCurveSize(controlPoints.size(), depth);
+  if (profileSize < 2) {
+    return comparison;
+  }
+  comparison.vertexCount = geometry::revolvedGridVertexCount(profileSize);
+
+  // interleaved [ p | n ] pairs
+  std::vector<math::Vec3f> captured(2 * comparison.vertexCount);
+  vertexBuffer.bind(BufferObject::ARRAY);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0,
+                     captured.size() * sizeof(math::Vec3f), captured.data());
+  vertexBuffer.unbind();
+
+  geometry::revolveSubdividedCurve(
+      controlPoints, depth,
+      geometry::revolutionSweep(controlPoints, depth, arena),
+      [&](std::size_t index, math::Vec3f const &vertex,
+          math::Vec3f const &normal) {
+        comparison.maxPositionError =
+            std::max(comparison.maxPositionError,
+                     math::distance(vertex, captured[2 * index]));
+        comparison.maxNormalError =
+            std::max(comparison.maxNormalError,
+                     math::distance(normal, captured[2 * index + 1]));
+      },
+      arena);
+
+  return comparison;
+}
+
+} // namespace opengl
@@ -0,0 +1,107 @@
+#include "flat_index_map.hpp"
+
+#include <cstdint>
+
+namespace memory {
+
+namespace {
+
+constexpr std::size_t EMPTY_KEY = ~std::size_t(0);
+
+// keep the table at most half full so probe runs stay short
+constexpr std::size_t MAX_LOAD_NUMERATOR = 1;
+constexpr std::size_t MAX_LOAD_DENOMINATOR = 2;
+
+} // namespace
+
+FlatIndexMap::FlatIndexMap(std::size_t expectedSize) {
+  std::size_t slotCount = 16;
+  while (slotCount * MAX_LOAD_NUMERATOR < expectedSize * MAX_LOAD_DENOMINATOR) {
+    slotCount *= 2;
+  }
+  rehash(slotCount);
+}
+
+std::pair<unsigned int, bool> FlatIndexMap::findOrInsert(std::size_t key,
+                                                        unsigned int value) {
+  if ((m_size + 1) * MAX_LOAD_DENOMINATOR >
+      m_slots.size() * MAX_LOAD_NUMERATOR) {
+    rehash(m_slots.size() * 2);
+  }
+
+  auto mask = m_slots.size() - 1;
+  for (auto i = slotFor(key);; i = (i + 1) & mask) {
+    auto &slot = m_slots[i];
+    if (slot.key == key) {
+      return {slot.value, false};
+    }
+    if (slot.key == EMPTY_KEY) {
+      slot.key = key;
+      slot.value = value;
+      ++m_size;
+      return {value, true};
+    }
+  }
+}
+
+unsigned int *FlatIndexMap::find(std::size_t key) {
+  auto i = findSlot(key);
+  return i == m_slots.size() ? nullptr : &m_slots[i].value;
+}
+
+unsigned int const *FlatIndexMap::find(std::size_t key) const {
+  auto i = findSlot(key);
+  return i == m_slots.size() ? nullptr : &m_slots[i].value;
+}
+
+std::size_t FlatIndexMap::size() const { return m_size; }
+
+void FlatIndexMap::clear() {
+  for (auto &slot : m_slots) {
+    slot.key = EMPTY_KEY;
+  }
+  m_size = 0;
+}
+
+void FlatIndexMap::rehash(std::size_t slotCount) {
+  std::vector<Slot> old(slotCount, Slot{EMPTY_KEY, 0});
+  std::swap(old, m_slots);
+
+  m_shift = 64;
+  for (auto n = slotCount; n > 1; n /= 2) {
+    --m_shift;
+  }
+
+  auto mask = m_slots.size() - 1;
+  for (auto const &slot : old) {
+    if (slot.key == EMPTY_KEY) {
+      continue;
+    }
+    auto i = slotFor(slot.key);
+    while (m_slots[i].key != EMPTY_KEY) {
+      i = (i + 1) & mask;
+    }
+    m_slots[i] = slot;
+  }
+}
+
+std::size_t FlatIndexMap::slotFor(std::size_t key) const {
+  // Fibonacci hashing, the top bits of key * 2^64 / phi pick the slot
+  return std::size_t((std::uint64_t(key) * 11400714819323198485ull) >>
+                     m_shift);
+}
+
+// slot holding key, or m_slots.size() if there is none
+std::size_t FlatIndexMap::findSlot(std::size_t key) const {
+  auto mask = m_slots.size() - 1;
+  for (auto i = slotFor(key);; i = (i + 1) & mask) {
+    if (m_slots[i].key == key) {
+      return i;
+    }
+    if (m_slots[i].key == EMPTY_KEY) {
+      return m_slots.size();
+    }
+  }
+}
+
+} // namespace memory
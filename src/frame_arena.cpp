@@ -0,0 +1,67 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace memory {
+
+FrameArena::FrameArena(std::size_t initialCapacity) {
+  addChunk(initialCapacity);
+}
+
+void *FrameArena::allocate(std::size_t bytes, std::size_t alignment) {
+  while (true) {
+    auto base = reinterpret_cast<std::uintptr_t>(m_chunks[m_current].get());
+    auto aligned = (base + m_offset + alignment - 1) & ~(alignment - 1);
+    auto end = aligned - base + bytes;
+
+    if (end <= m_chunkSizes[m_current]) {
+      m_bytesUsed += end - m_offset;
+      m_offset = end;
+      return reinterpret_cast<void *>(aligned);
+    }
+
+    // move on to the next chunk, growing if this was the last one
+    if (m_current + 1 == m_chunks.size()) {
+      addChunk(std::max(2 * m_chunkSizes[m_current], bytes + alignment));
+    }
+    ++m_current;
+    m_offset = 0;
+  }
+}
+
+void FrameArena::reset() {
+  if (m_chunks.size() > 1) {
+    // last rebuild spilled, merge everything into one chunk that fits it
+    std::size_t total = capacity();
+    m_chunks.clear();
+    m_chunkSizes.clear();
+    addChunk(total);
+  }
+
+  m_current = 0;
+  m_offset = 0;
+  m_bytesUsed = 0;
+}
+
+std::size_t FrameArena::bytesUsed() const { return m_bytesUsed; }
+
+std::size_t FrameArena::capacity() const {
+  std::size_t total = 0;
+  for (auto size : m_chunkSizes) {
+    total += size;
+  }
+  return total;
+}
+
+std::size_t FrameArena::upstreamAllocations() const {
+  return m_upstreamAllocations;
+}
+
+void FrameArena::addChunk(std::size_t minimumBytes) {
+  m_chunks.emplace_back(new char[minimumBytes]);
+  m_chunkSizes.push_back(minimumBytes);
+  ++m_upstreamAllocations;
+}
+
+} // namespace memory
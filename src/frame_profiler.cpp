@@ -0,0 +1,249 @@
+#include "frame_profiler.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+
+namespace profiling {
+
+namespace {
+
+constexpr char const *CLOCK_NAMES[FrameProfiler::CLOCK_COUNT] = {"cpu", "gpu"};
+
+double milliseconds(std::chrono::steady_clock::duration duration) {
+  return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+} // namespace
+
+RollingSamples::RollingSamples(std::size_t capacity)
+    : m_samples(std::max<std::size_t>(capacity, 1)) {}
+
+void RollingSamples::record(double milliseconds) {
+  m_samples[m_next] = milliseconds;
+  m_next = (m_next + 1) % m_samples.size();
+  m_count = std::min(m_count + 1, m_samples.size());
+}
+
+void RollingSamples::clear() {
+  m_next = 0;
+  m_count = 0;
+}
+
+std::size_t RollingSamples::count() const { return m_count; }
+
+double RollingSamples::percentile(double p) const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+
+  // only read on demand, so a copy is fine; while not full the samples are
+  // the first m_count, once full all of them
+  std::vector<double> sorted(m_samples.begin(), m_samples.begin() + m_count);
+  auto rank = std::size_t(std::ceil(p / 100.0 * m_count));
+  rank = std::min(std::max<std::size_t>(rank, 1), m_count);
+
+  std::nth_element(sorted.begin(), sorted.begin() + (rank - 1), sorted.end());
+  return sorted[rank - 1];
+}
+
+double RollingSamples::max() const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+  return *std::max_element(m_samples.begin(), m_samples.begin() + m_count);
+}
+
+FrameProfiler::CpuScope::CpuScope(FrameProfiler &profiler, Stage stage)
+    : m_profiler(profiler), m_stage(stage),
+      m_start(std::chrono::steady_clock::now()) {}
+
+FrameProfiler::CpuScope::~CpuScope() {
+  m_profiler.addCpuTime(m_stage,
+                        milliseconds(std::chrono::steady_clock::now() - m_start));
+}
+
+FrameProfiler::GpuScope::GpuScope(FrameProfiler &profiler, Stage stage)
+    : m_profiler(profiler), m_began(profiler.beginQuery(stage)) {}
+
+FrameProfiler::GpuScope::~GpuScope() {
+  if (m_began) {
+    m_profiler.endQuery();
+  }
+}
+
+FrameProfiler::FrameProfiler(std::size_t window) {
+  for (auto &stage : m_samples) {
+    for (auto &clock : stage) {
+      clock = RollingSamples(window);
+    }
+  }
+  m_cpuFrame.fill(-1.0);
+}
+
+void FrameProfiler::beginFrame() {
+  assert(!m_queryActive);
+
+  // the set this frame reuses was issued two frames ago
+  resolve(m_querySets[m_frame % 2]);
+  m_cpuFrame.fill(-1.0);
+}
+
+void FrameProfiler::endFrame() {
+  for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+    if (m_cpuFrame[stage] >= 0.0) {
+      m_samples[stage][CPU].record(m_cpuFrame[stage]);
+    }
+  }
+  ++m_frame;
+}
+
+void FrameProfiler::release() {
+  for (auto &set : m_querySets) {
+    for (auto &stage : set) {
+      if (!stage.queries.empty()) {
+        glDeleteQueries(GLsizei(stage.queries.size()), stage.queries.data());
+      }
+      stage.queries.clear();
+      stage.used = 0;
+    }
+  }
+}
+
+RollingSamples const &FrameProfiler::samples(Stage stage, Clock clock) const {
+  return m_samples[stage][clock];
+}
+
+std::size_t FrameProfiler::droppedGpuFrames() const {
+  return m_droppedGpuFrames;
+}
+
+void FrameProfiler::print(std::ostream &out) const {
+  auto flags = out.flags();
+  auto precision = out.precision();
+
+  for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+    for (std::size_t clock = 0; clock < CLOCK_COUNT; ++clock) {
+      auto const &samples = m_samples[stage][clock];
+      if (samples.count() == 0) {
+        continue;
+      }
+
+      out << std::left << std::setw(20) << stageName(Stage(stage)) << std::right
+          << CLOCK_NAMES[clock] << std::fixed << std::setprecision(3)
+          << "  p50 " << std::setw(8) << samples.percentile(50) << "  p95 "
+          << std::setw(8) << samples.percentile(95) << "  p99 " << std::setw(8)
+          << samples.percentile(99) << "  max " << std::setw(8)
+          << samples.max() << " ms  (" << samples.count() << " frames)\n";
+    }
+  }
+
+  out.flags(flags);
+  out.precision(precision);
+}
+
+void FrameProfiler::writeCSV(std::ostream &out) const {
+  out << "stage,clock,frames,p50_ms,p95_ms,p99_ms,max_ms\n";
+  for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+    for (std::size_t clock = 0; clock < CLOCK_COUNT; ++clock) {
+      auto const &samples = m_samples[stage][clock];
+      if (samples.count() == 0) {
+        continue;
+      }
+
+      out << stageName(Stage(stage)) << ',' << CLOCK_NAMES[clock] << ','
+          << samples.count() << ',' << samples.percentile(50) << ','
+          << samples.percentile(95) << ',' << samples.percentile(99) << ','
+          << samples.max() << '\n';
+    }
+  }
+}
+
+char const *FrameProfiler::stageName(Stage stage) {
+  switch (stage) {
+  case SUBDIVISION:
+    return "subdivision";
+  case REVOLVE:
+    return "revolve";
+  case NORMALS:
+    return "normals";
+  case VBO_PACKING:
+    return "vbo packing";
+  case UPLOAD:
+    return "upload";
+  case MESH_DRAW:
+    return "mesh draw";
+  case CONTROL_POINT_DRAW:
+    return "control point draw";
+  case FRAME:
+    return "frame";
+  default:
+    return "unknown";
+  }
+}
+
+void FrameProfiler::addCpuTime(Stage stage, double milliseconds) {
+  m_cpuFrame[stage] = std::max(m_cpuFrame[stage], 0.0) + milliseconds;
+}
+
+bool FrameProfiler::beginQuery(Stage stage) {
+  // GL has one GL_TIME_ELAPSED query active at a time, a nested scope is
+  // skipped and its time counts towards the enclosing one
+  if (m_queryActive) {
+    return false;
+  }
+
+  // a stage timed several times in a frame gets a query each time
+  auto &queries = m_querySets[m_frame % 2][stage];
+  if (queries.used == queries.queries.size()) {
+    GLuint query = 0;
+    glGenQueries(1, &query);
+    queries.queries.push_back(query);
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, queries.queries[queries.used++]);
+  m_queryActive = true;
+  return true;
+}
+
+void FrameProfiler::endQuery() {
+  glEndQuery(GL_TIME_ELAPSED);
+  m_queryActive = false;
+}
+
+void FrameProfiler::resolve(QuerySet &set) {
+  bool dropped = false;
+
+  for (std::size_t stage = 0; stage < STAGE_COUNT; ++stage) {
+    auto &queries = set[stage];
+    if (queries.used == 0) {
+      continue;
+    }
+
+    // queries finish in order, if the last one is available they all are
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(queries.queries[queries.used - 1],
+                       GL_QUERY_RESULT_AVAILABLE, &available);
+
+    if (available) {
+      GLuint64 total = 0;
+      for (std::size_t q = 0; q < queries.used; ++q) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries.queries[q], GL_QUERY_RESULT, &elapsed);
+        total += elapsed;
+      }
+      m_samples[stage][GPU].record(total / 1e6);
+    } else {
+      // waiting would stall the CPU on the GPU, the sample is lost instead
+      dropped = true;
+    }
+    queries.used = 0;
+  }
+
+  if (dropped) {
+    ++m_droppedGpuFrames;
+  }
+}
+
+} // namespace profiling
@@ -0,0 +1,80 @@
+#include "gl_extensions.hpp"
+
+#include <cstring>
+#include <iostream>
+
+namespace opengl {
+
+namespace {
+
+Extensions g_extensions;
+
+bool hasVersion(int major, int minor) {
+  GLint contextMajor = 0;
+  GLint contextMinor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &contextMajor);
+  glGetIntegerv(GL_MINOR_VERSION, &contextMinor);
+  return contextMajor > major ||
+         (contextMajor == major && contextMinor >= minor);
+}
+
+template <typename Function>
+void loadFunction(GLADloadproc load, char const *name, Function &function) {
+  function = reinterpret_cast<Function>(load(name));
+}
+
+} // namespace
+
+void loadExtensions(GLADloadproc load) {
+  Extensions found;
+
+  if (hasVersion(4, 1) || hasExtension("GL_ARB_get_program_binary")) {
+    loadFunction(load, "glGetProgramBinary", found.getProgramBinary);
+    loadFunction(load, "glProgramBinary", found.loadProgramBinary);
+    loadFunction(load, "glProgramParameteri", found.programParameteri);
+
+    // a driver may support the calls but no format to save in
+    GLint formats = 0;
+    glGetIntegerv(NUM_PROGRAM_BINARY_FORMATS, &formats);
+    found.programBinary = formats > 0 && found.getProgramBinary &&
+                          found.loadProgramBinary && found.programParameteri;
+  }
+
+  if (hasExtension("GL_KHR_parallel_shader_compile")) {
+    loadFunction(load, "glMaxShaderCompilerThreadsKHR",
+                 found.maxShaderCompilerThreads);
+  } else if (hasExtension("GL_ARB_parallel_shader_compile")) {
+    loadFunction(load, "glMaxShaderCompilerThreadsARB",
+                 found.maxShaderCompilerThreads);
+  }
+  found.parallelShaderCompile = found.maxShaderCompilerThreads != nullptr;
+  if (found.parallelShaderCompile) {
+    // as many threads as the driver likes
+    found.maxShaderCompilerThreads(MAX_SHADER_COMPILER_THREADS);
+  }
+
+  std::cout << "[Log] program binaries "
+            << (found.programBinary ? "supported" : "not supported") << '\n';
+  std::cout << "[Log] parallel shader compile "
+            << (found.parallelShaderCompile ? "supported" : "not supported")
+            << '\n';
+
+  g_extensions = found;
+}
+
+Extensions const &extensions() { return g_extensions; }
+
+bool hasExtension(char const *name) {
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    auto extension =
+        reinterpret_cast<char const *>(glGetStringi(GL_EXTENSIONS, i));
+    if (extension && std::strcmp(extension, name) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace opengl
@@ -0,0 +1,106 @@
+#include "index_buffer.hpp"
+
+#include <limits>
+
+#include "buffer_object.hpp"
+#include "trace.hpp"
+
+namespace opengl {
+
+namespace {
+
+bool isStrip(GLenum mode) {
+  return mode == GL_TRIANGLE_STRIP || mode == GL_LINE_STRIP;
+}
+
+} // namespace
+
+GLenum indexTypeFor(std::size_t vertexCount) {
+  // the largest index is vertexCount - 1, which must stay below the restart
+  // index 0xFFFF
+  return vertexCount <= std::numeric_limits<GLushort>::max()
+             ? GL_UNSIGNED_SHORT
+             : GL_UNSIGNED_INT;
+}
+
+std::size_t indexTypeSize(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+GLuint primitiveRestartIndex(GLenum indexType) {
+  return indexType == GL_UNSIGNED_SHORT ? std::numeric_limits<GLushort>::max()
+                                        : std::numeric_limits<GLuint>::max();
+}
+
+GLushort *IndexBufferView::shorts() const {
+  return type == GL_UNSIGNED_SHORT ? static_cast<GLushort *>(data) : nullptr;
+}
+
+GLuint *IndexBufferView::ints() const {
+  return type == GL_UNSIGNED_INT ? static_cast<GLuint *>(data) : nullptr;
+}
+
+IndexedDraw uploadIndices(std::vector<unsigned int> const &indices,
+                          std::size_t vertexCount, GLenum mode, GLenum usage) {
+  profiling::TraceScope trace("upload", "uploadIndices");
+
+  IndexedDraw draw;
+  draw.mode = mode;
+  draw.indexType = indexTypeFor(vertexCount);
+  draw.count = indices.size();
+
+  if (draw.indexType == GL_UNSIGNED_INT) {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,         // type
+                 sizeof(GLuint) * indices.size(), // size
+                 indices.data(),                  // data
+                 usage);
+    return draw;
+  }
+
+  // 32-bit restart indices become 16-bit ones
+  std::vector<GLushort> narrowed(indices.begin(), indices.end());
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER,            // type
+               sizeof(GLushort) * narrowed.size(), // size
+               narrowed.data(),                    // data
+               usage);
+  return draw;
+}
+
+IndexedDraw uploadIndices(std::size_t vertexCount, std::size_t indexCount,
+                          GLenum mode, FillIndices const &fill, GLenum usage) {
+  profiling::TraceScope trace("upload", "uploadIndices");
+
+  IndexedDraw draw;
+  draw.mode = mode;
+  draw.indexType = indexTypeFor(vertexCount);
+  draw.count = indexCount;
+
+  fillBufferMapped(GL_ELEMENT_ARRAY_BUFFER,
+                   indexTypeSize(draw.indexType) * indexCount, usage,
+                   [&](void *data) {
+                     IndexBufferView indices;
+                     indices.type = draw.indexType;
+                     indices.data = data;
+                     fill(indices);
+                   });
+  return draw;
+}
+
+void drawIndexed(IndexedDraw const &draw) {
+  if (isStrip(draw.mode)) {
+    glEnable(GL_PRIMITIVE_RESTART);
+    glPrimitiveRestartIndex(primitiveRestartIndex(draw.indexType));
+  }
+
+  glDrawElements(draw.mode,      // primitive
+                 draw.count,     // # of indices
+                 draw.indexType, // type of indices
+                 (void *)0       // offset
+                 );
+
+  if (isStrip(draw.mode)) {
+    glDisable(GL_PRIMITIVE_RESTART);
+  }
+}
+
+} // namespace opengl
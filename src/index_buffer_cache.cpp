@@ -0,0 +1,65 @@
+#include "index_buffer_cache.hpp"
+
+#include <algorithm>
+
+namespace opengl {
+
+bool operator==(IndexBufferKey const &lhs, IndexBufferKey const &rhs) {
+  return lhs.rows == rhs.rows && lhs.columns == rhs.columns &&
+         lhs.mode == rhs.mode;
+}
+
+bool operator!=(IndexBufferKey const &lhs, IndexBufferKey const &rhs) {
+  return !(lhs == rhs);
+}
+
+IndexBufferCache::IndexBufferCache(std::size_t capacity)
+    : m_capacity(std::max<std::size_t>(capacity, 1)) {
+  m_entries.reserve(m_capacity);
+}
+
+IndexedDraw IndexBufferCache::bind(IndexRequest const &request,
+                                   std::size_t vertexCount) {
+  auto const &key = request.key;
+  ++m_uses;
+
+  auto found = std::find_if(m_entries.begin(), m_entries.end(),
+                            [&](Entry const &e) { return e.key == key; });
+  if (found != m_entries.end()) {
+    ++m_hits;
+    found->lastUse = m_uses;
+    found->buffer.bind(BufferObject::ELEMENT_ARRAY);
+    return found->draw;
+  }
+
+  ++m_misses;
+
+  if (m_entries.size() == m_capacity) {
+    // reuse the least recently used buffer's name
+    found = std::min_element(m_entries.begin(), m_entries.end(),
+                             [](Entry const &a, Entry const &b) {
+                               return a.lastUse < b.lastUse;
+                             });
+  } else {
+    m_entries.push_back(Entry{key, makeBufferObject(), IndexedDraw(), 0});
+    found = m_entries.end() - 1;
+  }
+
+  found->key = key;
+  found->lastUse = m_uses;
+  found->buffer.bind(BufferObject::ELEMENT_ARRAY);
+  found->draw =
+      uploadIndices(vertexCount, request.count, key.mode, request.fill);
+  m_bytesUploaded += indexTypeSize(found->draw.indexType) * request.count;
+  return found->draw;
+}
+
+void IndexBufferCache::clear() { m_entries.clear(); }
+
+std::size_t IndexBufferCache::hits() const { return m_hits; }
+
+std::size_t IndexBufferCache::misses() const { return m_misses; }
+
+std::size_t IndexBufferCache::bytesUploaded() const { return m_bytesUploaded; }
+
+} // namespace opengl
@@ -0,0 +1,99 @@
+#include "latency_histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <string>
+
+namespace profiling {
+
+namespace {
+
+constexpr std::size_t BAR_WIDTH = 40;
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram(double bucketWidth, std::size_t bucketCount)
+    : m_bucketWidth(bucketWidth), m_buckets(std::max<std::size_t>(bucketCount, 1)) {}
+
+void LatencyHistogram::record(double milliseconds) {
+  ++m_buckets[bucketOf(milliseconds)];
+  ++m_count;
+  m_max = std::max(m_max, milliseconds);
+}
+
+void LatencyHistogram::clear() {
+  std::fill(m_buckets.begin(), m_buckets.end(), 0);
+  m_count = 0;
+  m_max = 0.0;
+}
+
+std::size_t LatencyHistogram::count() const { return m_count; }
+
+double LatencyHistogram::max() const { return m_max; }
+
+double LatencyHistogram::percentile(double p) const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+
+  // smallest bucket with at least p% of the samples at or below it
+  auto rank = std::size_t(std::ceil(p / 100.0 * m_count));
+  rank = std::max<std::size_t>(rank, 1);
+
+  std::size_t seen = 0;
+  for (std::size_t bucket = 0; bucket < m_buckets.size(); ++bucket) {
+    seen += m_buckets[bucket];
+    if (seen >= rank) {
+      // the overflow bucket has no upper edge
+      return bucket + 1 == m_buckets.size() ? m_max
+                                            : (bucket + 1) * m_bucketWidth;
+    }
+  }
+  return m_max;
+}
+
+double LatencyHistogram::fractionWithin(double milliseconds) const {
+  if (m_count == 0) {
+    return 0.0;
+  }
+
+  // buckets lying entirely within milliseconds
+  auto buckets = std::size_t(std::max(milliseconds, 0.0) / m_bucketWidth);
+  buckets = std::min(buckets, m_buckets.size() - 1);
+
+  std::size_t within = 0;
+  for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+    within += m_buckets[bucket];
+  }
+  return double(within) / m_count;
+}
+
+void LatencyHistogram::print(std::ostream &out) const {
+  auto fullest = *std::max_element(m_buckets.begin(), m_buckets.end());
+  if (fullest == 0) {
+    return;
+  }
+
+  for (std::size_t bucket = 0; bucket < m_buckets.size(); ++bucket) {
+    if (m_buckets[bucket] == 0) {
+      continue;
+    }
+
+    bool overflow = bucket + 1 == m_buckets.size();
+    out << std::setw(6) << bucket * m_bucketWidth << (overflow ? "+    " : " ms  ")
+        << std::string(BAR_WIDTH * m_buckets[bucket] / fullest + 1, '#') << ' '
+        << m_buckets[bucket] << '\n';
+  }
+}
+
+std::size_t LatencyHistogram::bucketOf(double milliseconds) const {
+  if (!(milliseconds > 0.0)) {
+    return 0;
+  }
+  auto bucket = milliseconds / m_bucketWidth;
+  return bucket >= m_buckets.size() - 1 ? m_buckets.size() - 1
+                                        : std::size_t(bucket);
+}
+
+} // namespace profiling
@@ -2,8 +2,19 @@
 #include <iostream>
 #include <vector>
 #include <sstream>
+#include <string>
 #include <cmath>
+#include <limits>
 #include <cassert> //assert
+#include <utility>
+#include <functional> //std::cref
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
 
 // glad beforw glfw
 #include "glad/glad.h"
@@ -24,6 +35,24 @@
 #include "buffer_object.hpp"
 #include "vertex_array_object.hpp"
 #include "vbo_tools.hpp"
+#include "curve_subdivision.hpp"
+#include "surface_of_revolution.hpp"
+#include "frame_arena.hpp"
+#include "allocation_counter.hpp"
+#include "vertex_welding.hpp"
+#include "texture_buffer.hpp"
+#include "feedback_revolution.hpp"
+#include "shader_variants.hpp"
+#include "program_binary_cache.hpp"
+#include "program_queue.hpp"
+#include "gl_extensions.hpp"
+#include "spsc_queue.hpp"
+#include "latest_value.hpp"
+#include "latency_histogram.hpp"
+#include "point_grid.hpp"
+#include "segment_bvh.hpp"
+#include "frame_profiler.hpp"
+#include "trace.hpp"
 //#include "texture.hpp"
 //#include "image.hpp"
 
@@ -40,139 +69,416 @@ Mat4f g_P = Mat4f::identity();
 
 GLuint g_width = 1000, g_height = 1000;
 
-//mouse button callback vars
-int pressed = 0; //0= nothing clicked, 1=left click, 2=right click
-int held = 0;	//when held is 1, the button is being held
+//pointer state, set by the input handlers and acted on once per frame by updatePointer()
+bool dragging = false;		  //left button held
+bool pickRequested = false;	  //left button pressed since the last frame
+bool removeRequested = false; //right button pressed since the last frame
+bool insertRequested = false; //shift + left button pressed since the last frame
+bool cursorMoved = false;	  //since the last frame
+int selectedPoint = -1;		  //control point being dragged, -1 for none
 
 std::vector<Vec3f> controlPoints;
 
+//controlPoints bucketed for picking, kept in step with every edit
+geometry::PointGrid controlPointGrid;
+
+//clicks further than this from every control point pick nothing (NDC)
+float const pickRadius = 0.1f;
+
 std::vector<Vec3f> outCurve;
 
 int depth = 1;
 
-double mouseX;
-double mouseY;
+//true: stream the revolved grid straight into the GPU buffers
+//false: build the triangle soup through OBJMesh (reference path)
+bool fusedPipeline = true;
+
+//reorder the reference pipeline's indices for the vertex cache
+bool optimizeIndices = false;
+
+//upload 16-bit positions and octahedral normals instead of floats
+bool packedVertices = false;
+
+//draw the fused pipeline's grid as triangle strips with primitive restart
+bool triangleStrips = false;
+
+//upload only the subdivided profile and revolve it in the vertex shader,
+//overrides both mesh pipelines while the profile fits a buffer texture
+bool gpuRevolution = false;
+
+//subdivide and revolve with transform feedback passes, capturing the grid
+//straight into the vertex buffer (overrides fused/reference)
+bool feedbackPipeline = false;
+
+//read the transform feedback grid back and compare it with the CPU's
+bool compareFeedback = false;
 
-double xClickedPos;
-double yClickedPos;
+//cull back faces of closed surfaces, open ones are always drawn double-sided
+bool backFaceCulling = true;
+
+//one normal per triangle instead of interpolated vertex normals
+bool flatShading = false;
+
+//point lights used, 1 .. opengl::ShaderFeatures::MAX_LIGHTS
+unsigned int lightCount = 1;
+
+//redraw every vsync instead of only when something changed (benchmarking)
+bool continuousRendering = false;
+
+//the last frame drawn is out of date, set from any thread through invalidateFrame()
+std::atomic<bool> frameInvalid(true);
+
+//The GL context lives on the render thread, the main thread only handles
+//GLFW events. Callbacks pass their arguments to the render thread through
+//inputEvents (and cursorPosition), which replays them into the handlers below,
+//so everything the handlers touch is only ever used by the render thread.
+struct InputEvent
+{
+	enum Type
+	{
+		KEY,
+		MOUSE_BUTTON,
+		FRAMEBUFFER_SIZE
+	};
+
+	Type type = KEY;
+	int code = 0; //key or mouse button
+	int scancode = 0;
+	int action = 0;
+	int mods = 0;
+	double x = 0.0; //cursor position at a button event, or framebuffer width and height
+	double y = 0.0;
+	std::chrono::steady_clock::time_point time; //when the callback ran
+};
+
+//key, button and resize events, none of which may be lost
+concurrency::SPSCQueue<InputEvent, 1024> inputEvents;
+
+//the latest cursor position, moves between two frames only matter for where they end
+struct CursorSample
+{
+	double x = 0.0;
+	double y = 0.0;
+	std::chrono::steady_clock::time_point time; //of the first move since the render thread last took one
+};
+
+concurrency::LatestValue<CursorSample> cursorPosition;
+
+//the render thread sleeps on this while there is nothing to do on demand,
+//the lock guards only the wakeup, never the events
+std::mutex renderWorkMutex;
+std::condition_variable renderWork;
+bool renderWorkPending = true;
+
+std::atomic<bool> stopRendering(false);
+
+//reference pipeline vertex storage, planar [ p | n ] or interleaved [ pn | pn ]
+opengl::VertexStorage vertexStorage = opengl::VertexStorage::Planar;
+
+//vertices closer than this are merged in the reference pipeline
+float const weldEpsilon = 1e-6f;
+
+//per rebuild temporaries, reset at the start of every rebuild
+memory::FrameArena frameArena;
+
+//what the fused pipeline's vertex buffer was last built from, so an edit
+//that only moves control points re-uploads just the rows it changed
+struct FusedGridState
+{
+	bool valid = false;
+	std::vector<Vec3f> controlPoints;
+	int depth = 0;
+	bool packed = false;
+	bool strips = false;
+	float sweep = 1.f;
+	geometry::SweptVolume volume; //decides the sweep, only the blocks an edit moves are redone
+	std::vector<opengl::VertexRange> rows; //the changed rows of each slice, reused between edits
+	bool closed = false; //whether the grid closes at the poles
+};
+
+FusedGridState fusedGrid;
+
+//what the GPU revolution's profile texture was last subdivided from
+struct GPUProfileState
+{
+	bool valid = false;
+	std::vector<Vec3f> controlPoints;
+	int depth = 0;
+	bool closed = false; //whether the revolved profile closes at the poles
+};
+
+GPUProfileState gpuProfile;
+
+//what the transform feedback pipeline last captured into the vertex buffer
+struct FeedbackGridState
+{
+	bool valid = false;
+	std::vector<Vec3f> controlPoints;
+	int depth = 0;
+	bool strips = false;
+	bool closed = false; //whether the captured grid closes at the poles
+};
+
+FeedbackGridState feedbackGrid;
+
+//the subdivided curve's segments for click-to-insert, and what they were
+//subdivided from
+struct CurvePickState
+{
+	bool valid = false;
+	std::vector<Vec3f> controlPoints;
+	int depth = 0;
+	std::vector<Vec3f> curve; //reused between rebuilds
+	geometry::SegmentBVH segments;
+};
 
-double closestPointToCursor;
-double closestDistanceOfPoint;
+CurvePickState curvePick;
 
+//latest cursor position in the control point viewport
 double ndcX;
 double ndcY;
 
-// function declaration
-using namespace std;
+//where the requested pick or insert, and the requested removal, were pressed
+double pressX, pressY;
+double removeX, removeY;
 
-static void cursorPositionCallback(GLFWwindow *window, double xpos, double ypos)
-{
-	//screenspace position of x and y for cursor
-	ndcX = (xpos - ((float)g_width * (3.f / 4.f))) / ((float)g_width / 4.f);
-	ndcY = (ypos - ((float)g_height) / 2.f) / (-(float)g_height / 2.f);
+//milliseconds between vsyncs of the primary monitor
+double framePeriod = 1000.0 / 60.0;
 
-	//get closest point to mouse within some allowable distance
-	if (pressed == 1)
-	{
-		//update position of where cursor was clicked
-		xClickedPos = ndcX;
-		yClickedPos = ndcY;
+//from the oldest input a frame applied to that frame's swap
+profiling::LatencyHistogram inputLatency(1.0, 100);
 
-		//grab closest point to cursor
-		closestDistanceOfPoint = -1;
-		closestPointToCursor = -1;
+//per stage CPU and GPU times of the last 512 frames drawn
+using Profiler = profiling::FrameProfiler;
+Profiler frameProfiler(512);
 
-		if ((ndcX <= 1.f) && (ndcX >= -1.f) && (ndcY <= 1.f) && (ndcY >= -1.f))
-		{
-			//go through every point and check distance to cursor
-			for (int i = 0; i < controlPoints.size(); i++)
-			{
-				//pythagorean
-				double distanceOfCurrentPointToCursor = pow(pow((ndcX - controlPoints[i].x), 2) + pow((ndcY - controlPoints[i].y), 2), 0.5f);
+//frames captured by one trace (Y), written to frame_trace.json
+std::size_t const traceFrames = 120;
 
-				if (closestDistanceOfPoint == -1)
-				{
-					closestDistanceOfPoint = distanceOfCurrentPointToCursor;
-					closestPointToCursor = i;
-				}
-				else if (closestDistanceOfPoint > distanceOfCurrentPointToCursor)
-				{
-					closestDistanceOfPoint = distanceOfCurrentPointToCursor;
-					closestPointToCursor = i;
-				}
-			}
-		}
+// function declaration
+using namespace std;
 
-		pressed = 0;
+//wakes the render thread if it is waiting for work, from any thread
+void wakeRenderThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(renderWorkMutex);
+		renderWorkPending = true;
 	}
+	renderWork.notify_one();
+}
 
-	//point movement
-	if (held == 1)
-	{
-		double xMovementAmt = ndcX - xClickedPos;
-		double yMovementAmt = ndcY - yClickedPos;
+//render thread only, blocks until wakeRenderThread()
+void waitForRenderWork()
+{
+	std::unique_lock<std::mutex> lock(renderWorkMutex);
+	renderWork.wait(lock, [] { return renderWorkPending; });
+	renderWorkPending = false;
+}
 
-		controlPoints[closestPointToCursor].x = ndcX;
-		controlPoints[closestPointToCursor].y = ndcY;
-	}
+//requests a redraw, from any thread
+void invalidateFrame()
+{
+	frameInvalid = true;
+	wakeRenderThread();
+}
+
+//moves are coalesced, only the position of each button event and the latest
+//of a frame arrive here
+static void cursorPositionCallback(GLFWwindow *window, double xpos, double ypos)
+{
+	//screenspace position of x and y for cursor
+	ndcX = (xpos - ((float)g_width * (3.f / 4.f))) / ((float)g_width / 4.f);
+	ndcY = (ypos - ((float)g_height) / 2.f) / (-(float)g_height / 2.f);
+
+	cursorMoved = true;
 }
 
 /*
  * Left click (1) is selected/drag if button is held
  *
+ * Shift + left click on the curve inserts a point there, then drags it
+ *
  * Right click (2) on point is point removal
  */
 void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
 {
 	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
 	{
-		pressed = 1;
-		held = 1;
+		if (mods & GLFW_MOD_SHIFT)
+			insertRequested = true;
+		else
+			pickRequested = true;
+		pressX = ndcX;
+		pressY = ndcY;
+		dragging = true;
 	}
 	//remove points
 	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_PRESS)
 	{
-		pressed = 2;
+		removeRequested = true;
+		removeX = ndcX;
+		removeY = ndcY;
+	}
+	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
+	{
+		dragging = false;
+	}
+}
 
-		xClickedPos = ndcX;
-		yClickedPos = ndcY;
+//control point closest to the cursor within pickRadius, -1 if there is none or
+//the cursor is outside the viewport
+int closestControlPoint(double x, double y)
+{
+	if ((x > 1.f) || (x < -1.f) || (y > 1.f) || (y < -1.f))
+		return -1;
 
-		//if cursor within bounds of viewport
-		if ((ndcX <= 1.f) && (ndcX >= -1.f) && (ndcY <= 1.f) && (ndcY >= -1.f))
-		{
-			//reset distance and points
-			closestDistanceOfPoint = -1;
-			closestPointToCursor = -1;
-			//go through every point and check distance to cursor
-			for (int i = 0; i < controlPoints.size(); i++)
-			{
-				//pythagorean
-				double distanceOfCurrentPointToCursor = pow(pow((ndcX - controlPoints[i].x), 2) + pow((ndcY - controlPoints[i].y), 2), 0.5f);
+	return int(controlPointGrid.nearest(controlPoints, float(x), float(y), pickRadius));
+}
 
-				//find closest point
-				if (closestDistanceOfPoint == -1 || closestDistanceOfPoint > distanceOfCurrentPointToCursor)
-				{
-					closestDistanceOfPoint = distanceOfCurrentPointToCursor;
-					closestPointToCursor = i;
-				}
-			}
-		}
+void subdivideOpenCurve(std::vector<Vec3f> const &points, std::vector<Vec3f> &out);
+void changedControlPoints(std::vector<Vec3f> const &previous, std::vector<Vec3f> const &current,
+						  std::size_t &first, std::size_t &last);
+
+//The first two and the last two control points decide whether the profile
+//reaches the axis, so within pickRadius of it they snap onto x = 0
+Vec3f snappedToAxis(int index, int count, Vec3f point)
+{
+	bool end = index < 2 || index >= count - 2;
+	if (end && std::abs(point.x) < pickRadius)
+		point.x = 0.f;
+	return point;
+}
+
+//Inserts a control point where the subdivided curve passes within pickRadius
+//of (x, y), into the control span that part of the curve comes from.
+//Returns its index, -1 if the curve is not that close.
+int insertControlPointOnCurve(double x, double y)
+{
+	profiling::TraceScope trace("input", "insertControlPointOnCurve");
+
+	if ((x > 1.f) || (x < -1.f) || (y > 1.f) || (y < -1.f) || controlPoints.size() < 2)
+		return -1;
 
-		//keep at only 4 control points
-		if (controlPoints.size() > 4)
+	//the hierarchy is rebuilt only after the curve changed
+	bool stale = !curvePick.valid || curvePick.depth != depth ||
+				 curvePick.controlPoints.size() != controlPoints.size();
+	if (!stale)
+	{
+		std::size_t first, last;
+		changedControlPoints(curvePick.controlPoints, controlPoints, first, last);
+		stale = first < last;
+	}
+
+	if (stale)
+	{
+		subdivideOpenCurve(controlPoints, curvePick.curve);
+		curvePick.segments.build(curvePick.curve);
+		curvePick.valid = true;
+		curvePick.controlPoints = controlPoints;
+		curvePick.depth = depth;
+	}
+
+	geometry::SegmentHit hit;
+	if (!curvePick.segments.nearest(float(x), float(y), pickRadius, hit))
+		return -1;
+
+	//the new point goes between the ends of its span
+	double parameter = geometry::controlPolygonParameter(hit.segment + hit.t, depth);
+	int span = std::min(std::max(int(std::floor(parameter)), 0), int(controlPoints.size()) - 2);
+	int index = span + 1;
+
+	Vec3f point = snappedToAxis(index, int(controlPoints.size()) + 1, hit.point);
+	controlPoints.insert(controlPoints.begin() + index, point);
+	controlPointGrid.insert(index, point);
+	return index;
+}
+
+//Once per frame, after the frame's input: hit-tests where the buttons were
+//pressed and moves or removes points
+void updatePointer()
+{
+	profiling::TraceScope trace("input", "update pointer");
+
+	if (removeRequested)
+	{
+		removeRequested = false;
+
+		//keep at least 4 control points
+		int closest = closestControlPoint(removeX, removeY);
+		if (closest != -1 && controlPoints.size() > 4)
 		{
-			controlPoints.erase(controlPoints.begin() + closestPointToCursor);
+			controlPointGrid.erase(closest, controlPoints[closest]);
+			controlPoints.erase(controlPoints.begin() + closest);
+			selectedPoint = -1;
+			invalidateFrame();
 		}
 	}
-	if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_RELEASE)
+
+	if (insertRequested)
+	{
+		insertRequested = false;
+		selectedPoint = insertControlPointOnCurve(pressX, pressY);
+		if (selectedPoint != -1)
+			invalidateFrame();
+	}
+
+	if (pickRequested)
+	{
+		pickRequested = false;
+		selectedPoint = closestControlPoint(pressX, pressY);
+	}
+
+	//point movement
+	if (dragging && cursorMoved && selectedPoint != -1)
 	{
-		pressed = 0;
-		held = 0;
+		Vec3f moved = controlPoints[selectedPoint];
+		moved.x = ndcX;
+		moved.y = ndcY;
+		moved = snappedToAxis(selectedPoint, int(controlPoints.size()), moved);
+		controlPointGrid.move(selectedPoint, controlPoints[selectedPoint], moved);
+		controlPoints[selectedPoint] = moved;
+		invalidateFrame();
 	}
-	if (button == GLFW_MOUSE_BUTTON_RIGHT && action == GLFW_RELEASE)
+
+	cursorMoved = false;
+}
+
+void printInputLatency()
+{
+	if (inputLatency.count() == 0)
+		return;
+
+	std::cout << "[Log] input to photon latency over " << inputLatency.count() << " frames: p50 "
+			  << inputLatency.percentile(50) << " ms, p95 " << inputLatency.percentile(95)
+			  << " ms, p99 " << inputLatency.percentile(99) << " ms, max " << inputLatency.max()
+			  << " ms, " << 100.0 * inputLatency.fractionWithin(framePeriod) << "% within one frame ("
+			  << framePeriod << " ms)\n";
+	inputLatency.print(std::cout);
+}
+
+void printFrameStages()
+{
+	if (frameProfiler.samples(Profiler::FRAME, Profiler::CPU).count() == 0)
+		return;
+
+	std::cout << "[Log] frame stages over the last "
+			  << frameProfiler.samples(Profiler::FRAME, Profiler::CPU).count() << " frames ("
+			  << frameProfiler.droppedGpuFrames() << " frames of GPU times not ready in time):\n";
+	frameProfiler.print(std::cout);
+}
+
+void writeFrameStagesCSV(std::string const &filename)
+{
+	std::ofstream file(filename);
+	if (!file)
 	{
-		pressed = 0;
+		std::cerr << "[Error] could not write " << filename << '\n';
+		return;
 	}
+
+	frameProfiler.writeCSV(file);
+	std::cout << "[Log] frame stages written to " << filename << '\n';
 }
 
 void setFrameBufferSize(GLFWwindow *window, int width, int height)
@@ -182,11 +488,20 @@ void setFrameBufferSize(GLFWwindow *window, int width, int height)
 	glViewport(0, 0, g_width, g_height);
 	float aspect_ratio = float(g_width) / g_height;
 	g_P = orthographicProjection(-aspect_ratio, aspect_ratio, 1, -1, 0.001f, 10);
+	invalidateFrame();
+}
+
+//the window system lost the window's contents (uncovered, restored)
+void refreshWindow(GLFWwindow *window)
+{
+	invalidateFrame();
 }
 
 void setKeyboard(GLFWwindow *window, int key, int scancode, int action,
 				 int mods)
 {
+	//every key changes the model, the view or how it is drawn
+	invalidateFrame();
 
 	if (GLFW_KEY_LEFT == key)
 	{
@@ -251,6 +566,159 @@ void setKeyboard(GLFWwindow *window, int key, int scancode, int action,
 		{
 			Vec3f temp(0, 0, 0);
 			controlPoints.push_back(temp);
+			controlPointGrid.insert(controlPoints.size() - 1, temp);
+		}
+	}
+	else if (GLFW_KEY_F == key)
+	{
+		//toggle fused/reference mesh pipeline
+		if (GLFW_PRESS == action)
+		{
+			fusedPipeline = !fusedPipeline;
+			std::cout << "[Log] " << (fusedPipeline ? "fused" : "reference")
+					  << " mesh pipeline\n";
+		}
+	}
+	else if (GLFW_KEY_O == key)
+	{
+		//toggle index order optimization in the reference pipeline
+		if (GLFW_PRESS == action)
+		{
+			optimizeIndices = !optimizeIndices;
+			std::cout << "[Log] index order optimization "
+					  << (optimizeIndices ? "on" : "off") << '\n';
+		}
+	}
+	else if (GLFW_KEY_K == key)
+	{
+		//toggle packed vertex attributes
+		if (GLFW_PRESS == action)
+		{
+			packedVertices = !packedVertices;
+			std::cout << "[Log] " << (packedVertices ? "packed" : "float")
+					  << " vertex attributes\n";
+		}
+	}
+	else if (GLFW_KEY_I == key)
+	{
+		//toggle interleaved/planar vertex storage in the reference pipeline
+		if (GLFW_PRESS == action)
+		{
+			bool interleaved = vertexStorage == opengl::VertexStorage::Interleaved;
+			vertexStorage = interleaved ? opengl::VertexStorage::Planar
+										: opengl::VertexStorage::Interleaved;
+			std::cout << "[Log] " << (interleaved ? "planar" : "interleaved")
+					  << " vertex storage\n";
+		}
+	}
+	else if (GLFW_KEY_T == key)
+	{
+		//toggle triangle strips/lists for the fused pipeline's grid
+		if (GLFW_PRESS == action)
+		{
+			triangleStrips = !triangleStrips;
+			std::cout << "[Log] " << (triangleStrips ? "triangle strips" : "triangle lists")
+					  << " for the revolved grid\n";
+		}
+	}
+	else if (GLFW_KEY_G == key)
+	{
+		//toggle revolving the profile on the GPU
+		if (GLFW_PRESS == action)
+		{
+			gpuRevolution = !gpuRevolution;
+			std::cout << "[Log] revolution on the " << (gpuRevolution ? "GPU" : "CPU") << '\n';
+		}
+	}
+	else if (GLFW_KEY_X == key)
+	{
+		//toggle the transform feedback pipeline
+		if (GLFW_PRESS == action)
+		{
+			feedbackPipeline = !feedbackPipeline;
+			std::cout << "[Log] transform feedback pipeline "
+					  << (feedbackPipeline ? "on" : "off") << '\n';
+		}
+	}
+	else if (GLFW_KEY_V == key)
+	{
+		//toggle comparing the transform feedback pipeline with the CPU
+		if (GLFW_PRESS == action)
+		{
+			compareFeedback = !compareFeedback;
+			//captured again, so the comparison runs right away
+			feedbackGrid.valid = false;
+			std::cout << "[Log] CPU reference comparison "
+					  << (compareFeedback ? "on" : "off") << '\n';
+		}
+	}
+	else if (GLFW_KEY_B == key)
+	{
+		//toggle back face culling for closed surfaces
+		if (GLFW_PRESS == action)
+		{
+			backFaceCulling = !backFaceCulling;
+			std::cout << "[Log] back face culling " << (backFaceCulling ? "on" : "off") << '\n';
+		}
+	}
+	else if (GLFW_KEY_Q == key)
+	{
+		//toggle flat/smooth shading
+		if (GLFW_PRESS == action)
+		{
+			flatShading = !flatShading;
+			std::cout << "[Log] " << (flatShading ? "flat" : "smooth") << " shading\n";
+		}
+	}
+	else if (GLFW_KEY_L == key)
+	{
+		//cycle through the number of lights
+		if (GLFW_PRESS == action)
+		{
+			lightCount = lightCount % opengl::ShaderFeatures::MAX_LIGHTS + 1;
+			std::cout << "[Log] " << lightCount << " light(s)\n";
+		}
+	}
+	else if (GLFW_KEY_R == key)
+	{
+		//toggle redrawing every frame/only on changes
+		if (GLFW_PRESS == action)
+		{
+			continuousRendering = !continuousRendering;
+			std::cout << "[Log] " << (continuousRendering ? "continuous" : "on demand")
+					  << " rendering\n";
+		}
+	}
+	else if (GLFW_KEY_H == key)
+	{
+		//print the input to photon latency histogram
+		if (GLFW_PRESS == action)
+		{
+			printInputLatency();
+		}
+	}
+	else if (GLFW_KEY_J == key)
+	{
+		//print the per stage frame time percentiles
+		if (GLFW_PRESS == action)
+		{
+			printFrameStages();
+		}
+	}
+	else if (GLFW_KEY_Y == key)
+	{
+		//capture a trace of the next frames
+		if (GLFW_PRESS == action)
+		{
+			profiling::startTrace(traceFrames, "frame_trace.json");
+		}
+	}
+	else if (GLFW_KEY_C == key)
+	{
+		//dump the per stage frame time percentiles
+		if (GLFW_PRESS == action)
+		{
+			writeFrameStagesCSV("frame_stages.csv");
 		}
 	}
 	else if (GLFW_KEY_9 == key)
@@ -275,21 +743,180 @@ void setKeyboard(GLFWwindow *window, int key, int scancode, int action,
 	}
 	else if (GLFW_KEY_ESCAPE == key)
 	{
+		//the main thread sleeps in glfwWaitEvents, wake it to see this
 		glfwSetWindowShouldClose(window, GLFW_TRUE);
+		glfwPostEmptyEvent();
+	}
+}
+
+//main thread: the GLFW callbacks only queue their arguments
+
+void pushInputEvent(InputEvent event)
+{
+	profiling::TraceScope trace("input", "queue input event");
+
+	event.time = std::chrono::steady_clock::now();
+	//a lost release would leave a drag stuck, so a full queue waits for the
+	//render thread to drain it instead of dropping the event
+	while (!inputEvents.push(event))
+	{
+		wakeRenderThread();
+		std::this_thread::yield();
 	}
+	wakeRenderThread();
+}
+
+void queueKey(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+	InputEvent event;
+	event.type = InputEvent::KEY;
+	event.code = key;
+	event.scancode = scancode;
+	event.action = action;
+	event.mods = mods;
+	pushInputEvent(event);
+}
+
+void queueMouseButton(GLFWwindow *window, int button, int action, int mods)
+{
+	InputEvent event;
+	event.type = InputEvent::MOUSE_BUTTON;
+	event.code = button;
+	event.action = action;
+	event.mods = mods;
+	//the button acts where it was pressed, whatever moves are taken with it
+	glfwGetCursorPos(window, &event.x, &event.y);
+	pushInputEvent(event);
+}
+
+void queueCursorPosition(GLFWwindow *window, double xpos, double ypos)
+{
+	profiling::TraceScope trace("input", "store cursor position");
+
+	static CursorSample sample;
+	auto now = std::chrono::steady_clock::now();
+	if (cursorPosition.taken())
+		sample.time = now;
+	sample.x = xpos;
+	sample.y = ypos;
+	cursorPosition.store(sample);
+	wakeRenderThread();
 }
 
-// user defined alias
-opengl::Program createShaderProgram(std::string const &vertexShaderFile,
-									std::string const &fragmentShaderFile)
+void queueFrameBufferSize(GLFWwindow *window, int width, int height)
+{
+	InputEvent event;
+	event.type = InputEvent::FRAMEBUFFER_SIZE;
+	event.x = width;
+	event.y = height;
+	pushInputEvent(event);
+}
+
+//Render thread: replays everything queued since the last frame, in order,
+//then moves the cursor to its latest position. A button event carries the
+//cursor position it happened at, a press records it there, and picking waits
+//for updatePointer().
+//Returns false if nothing was queued, else oldest is when the first event arrived.
+bool applyInputEvents(GLFWwindow *window, std::chrono::steady_clock::time_point &oldest)
+{
+	profiling::TraceScope trace("input", "apply input events");
+
+	bool applied = false;
+
+	InputEvent event;
+	while (inputEvents.pop(event))
+	{
+		if (!applied)
+			oldest = event.time;
+		applied = true;
+
+		switch (event.type)
+		{
+		case InputEvent::KEY:
+			setKeyboard(window, event.code, event.scancode, event.action, event.mods);
+			break;
+		case InputEvent::MOUSE_BUTTON:
+			cursorPositionCallback(window, event.x, event.y);
+			mouseButtonCallback(window, event.code, event.action, event.mods);
+			break;
+		case InputEvent::FRAMEBUFFER_SIZE:
+			setFrameBufferSize(window, int(event.x), int(event.y));
+			break;
+		}
+	}
+
+	CursorSample cursor;
+	if (cursorPosition.take(cursor))
+	{
+		if (!applied || cursor.time < oldest)
+			oldest = cursor.time;
+		applied = true;
+		cursorPositionCallback(window, cursor.x, cursor.y);
+	}
+
+	return applied;
+}
+
+// user defined alias, the program is compiled on first use
+opengl::ProgramQueue::Handle createShaderProgram(opengl::ProgramQueue &programs,
+												 std::string const &vertexShaderFile,
+												 std::string const &fragmentShaderFile)
 {
 	using namespace opengl;
 	auto vertexShaderSource = loadShaderStringFromFile(vertexShaderFile);
 	auto fragmentShaderSource = loadShaderStringFromFile(fragmentShaderFile);
 
-	std::cout << "[Log] compiling program " << vertexShaderFile << ' '
-			  << fragmentShaderFile << '\n';
-	return opengl::makeProgram(vertexShaderSource, fragmentShaderSource);
+	return programs.add(vertexShaderFile + ' ' + fragmentShaderFile,
+						vertexShaderSource, fragmentShaderSource);
+}
+
+//the leanest phong permutation for the current configuration
+opengl::ShaderFeatures phongFeatures(bool revolveOnGPU)
+{
+	opengl::ShaderFeatures features;
+	if (revolveOnGPU)
+		features.flags |= opengl::ShaderFeatures::REVOLVED_PROFILE;
+	else if (packedVertices)
+		features.flags |= opengl::ShaderFeatures::PACKED_VERTICES;
+	if (flatShading)
+		features.flags |= opengl::ShaderFeatures::FLAT_SHADING;
+	features.lightCount = lightCount;
+	return features;
+}
+
+//a and b read the same vertex attributes and geometry uniforms, either draws the other's vertex data
+bool sameVertexInputs(opengl::ShaderFeatures const &a, opengl::ShaderFeatures const &b)
+{
+	using opengl::ShaderFeatures;
+
+	unsigned const inputs = ShaderFeatures::PACKED_VERTICES | ShaderFeatures::REVOLVED_PROFILE;
+	return (a.flags & inputs) == (b.flags & inputs);
+}
+
+//the permutations one key press away from features
+void prepareNearbyVariants(opengl::ProgramVariants &variants, opengl::ShaderFeatures const &features)
+{
+	using opengl::ShaderFeatures;
+
+	auto flat = features;
+	flat.flags ^= ShaderFeatures::FLAT_SHADING;
+	variants.prepare(flat);
+
+	auto lights = features;
+	lights.lightCount = features.lightCount % ShaderFeatures::MAX_LIGHTS + 1;
+	variants.prepare(lights);
+
+	auto revolved = features;
+	revolved.flags ^= ShaderFeatures::REVOLVED_PROFILE;
+	revolved.flags &= ~unsigned(ShaderFeatures::PACKED_VERTICES);
+	variants.prepare(revolved);
+
+	if (!(features.flags & ShaderFeatures::REVOLVED_PROFILE))
+	{
+		auto packed = features;
+		packed.flags ^= ShaderFeatures::PACKED_VERTICES;
+		variants.prepare(packed);
+	}
 }
 
 std::string glfwVersion()
@@ -304,6 +931,8 @@ std::string glfwVersion()
 
 bool loadGeometryToGPU(std::vector<Vec3f> const &vertices, GLuint vboID)
 {
+	profiling::TraceScope trace("upload", "loadGeometryToGPU");
+
 	glBindBuffer(GL_ARRAY_BUFFER, vboID);
 	glBufferData(
 		GL_ARRAY_BUFFER,				 // destination
@@ -315,37 +944,92 @@ bool loadGeometryToGPU(std::vector<Vec3f> const &vertices, GLuint vboID)
 	return true;
 }
 
-//takes in a vector of vec3f and rotates every vec3f in it by 5 degrees around the y axis
-std::vector<Vec3f> rotateLineAroundAxis(std::vector<Vec3f> const &points, int degrees)
+//writes the revolved grid's indices in whatever width the upload picked
+void writeGridIndices(std::size_t profileSize, opengl::IndexBufferView const &indices)
 {
-	Vec3f yAxis(0, 1, 0);
+	if (indices.type == GL_UNSIGNED_SHORT)
+	{
+		if (triangleStrips)
+			geometry::makeRevolvedGridStripIndices(profileSize, indices.shorts());
+		else
+			geometry::makeRevolvedGridIndices(profileSize, indices.shorts());
+	}
+	else
+	{
+		if (triangleStrips)
+			geometry::makeRevolvedGridStripIndices(profileSize, indices.ints());
+		else
+			geometry::makeRevolvedGridIndices(profileSize, indices.ints());
+	}
+}
+
+//the revolved grid's indices depend only on its size and the primitive mode,
+//so they are uploaded once per topology and reused while points are dragged
+opengl::IndexRequest gridIndexRequest(std::size_t profileSize)
+{
+	opengl::IndexRequest request;
+	request.key.rows = geometry::REVOLUTION_SLICES;
+	request.key.columns = profileSize;
+	request.key.mode = triangleStrips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+	request.count = triangleStrips ? geometry::revolvedGridStripIndexCount(profileSize)
+								   : geometry::revolvedGridIndexCount(profileSize);
+	request.fill = [profileSize](opengl::IndexBufferView const &indices) {
+		writeGridIndices(profileSize, indices);
+	};
+	return request;
+}
 
-	std::vector<Vec3f> rotated;
+//narrows [first, last) to the control points that differ between previous and
+//current (same size), an empty range if none moved
+void changedControlPoints(std::vector<Vec3f> const &previous, std::vector<Vec3f> const &current,
+						  std::size_t &first, std::size_t &last)
+{
+	first = 0;
+	last = current.size();
+
+	auto same = [&](std::size_t i) {
+		return previous[i].x == current[i].x && previous[i].y == current[i].y &&
+			   previous[i].z == current[i].z;
+	};
+
+	while (first < last && same(first))
+		++first;
+	while (last > first && same(last - 1))
+		--last;
+}
+
+//takes in a vector of vec3f, rotates every vec3f in it around the y axis and
+//appends the results to rotated
+void rotateLineAroundAxis(std::vector<Vec3f> const &points, int degrees,
+						  memory::ArenaVector<Vec3f> &rotated)
+{
+	Vec3f yAxis(0, 1, 0);
 
 	for (int i = 0; i < points.size(); i++)
 	{
-		Vec3f temp = math::rotateAroundAxis(points[i], yAxis, degrees);
-		rotated.push_back(temp);
+		rotated.push_back(math::rotateAroundAxis(points[i], yAxis, degrees));
 	}
-
-	return rotated;
 }
 
 std::vector<Vec3f> createTriangleMesh(std::vector<Vec3f> const &curve)
 {
-	std::vector<Vec3f> points;
+	profiling::TraceScope trace("mesh", "createTriangleMesh");
+
+	//rotated copies only live until the triangles are built
+	memory::ArenaVector<Vec3f> points{memory::ArenaAllocator<Vec3f>(frameArena)};
 	std::vector<Vec3f> meshPoints;
 
+	//exact sizes, 72 rotated curves and 2 triangles per quad
+	points.reserve(72 * curve.size());
+	meshPoints.reserve(72 * (curve.size() - 1) * 6);
+
+	//sweep whichever way makes the triangles wind counter-clockwise from outside
+	int sweep = int(geometry::revolutionSweep(curve));
+
 	//we rotate by 5 degrees, so we need 72 rotations for a 360 degree object
 	for (int i = 0; i < 72; i++)
 	{
-		std::vector<Vec3f> temp = rotateLineAroundAxis(curve, i * 5);
-
-		//copy over result to points
-		for (int j = 0; j < curve.size(); j++)
-		{
-			points.push_back(temp[j]);
-		}
+		rotateLineAroundAxis(curve, sweep * i * 5, points);
 	}
 
 	//actually create the triangle mesh now
@@ -388,7 +1072,10 @@ std::vector<Vec3f> createTriangleMesh(std::vector<Vec3f> const &curve)
 }
 
 std::vector<IndicesTriangle> createIndices(std::vector<Vec3f> const &triangles) {
+    profiling::TraceScope trace("mesh", "createIndices");
+
     std::vector<IndicesTriangle> indicesTrianglesList;
+    indicesTrianglesList.reserve(triangles.size() / 3);
 
     //create indices based on triangles
     for(int i = 0; i < triangles.size() - 2; i += 3) {
@@ -421,46 +1108,25 @@ std::vector<Vec3f> subdivideClosedCurve(std::vector<Vec3f> const &points, int de
 	return out;
 }
 
-std::vector<Vec3f> subdivideOpenCurve(std::vector<Vec3f> const &points)
+//subdivides points to the current depth into out
+void subdivideOpenCurve(std::vector<Vec3f> const &points, std::vector<Vec3f> &out)
 {
-	//guarenteed to always have minimum 4 points in points
-	std::vector<Vec3f> out;
+	Profiler::CpuScope subdivisionTime(frameProfiler, Profiler::SUBDIVISION);
+	profiling::TraceScope trace("mesh", "subdivideOpenCurve");
 
-	for (int d = 0; d < depth; d++)
+	//guarenteed to always have minimum 4 points in points
+	//long digitized profiles are split across threads, which (and their
+	//scratch) are started with the first one and kept for the next
+	if (points.size() >= geometry::PARALLEL_SUBDIVISION_THRESHOLD)
 	{
-		std::vector<Vec3f> temp;
-
-		if (d == 0)
-		{
-			for (int b = 0; b < points.size(); b++)
-			{
-				temp.push_back(points[b]);
-			}
-		}
-		else
-		{
-			for (int b = 0; b < out.size(); b++)
-			{
-				temp.push_back(out[b]);
-			}
-		}
-
-		out.clear();
-		//loop over all points, subdivide
-		int i = 0;
-		int j = 1;
-
-		//chaikin
-		for (i = 0, j = 1; (i < temp.size() - 1) && (j < temp.size()); i++, j++)
-		{
-			Vec3f pA = temp[i];
-			Vec3f pB = temp[j];
-
-			out.push_back(lerp(pA, pB, 0.25));
-			out.push_back(lerp(pA, pB, 0.75));
-		}
+		static geometry::SubdivisionWorkers subdivisionWorkers;
+		geometry::subdivideOpenCurveParallel(points, depth, subdivisionWorkers, out);
+		return;
 	}
-	return out;
+
+	//shorter ones ping-pong between out and frameArena, reusing both
+	geometry::SubdivisionScratch scratch(frameArena);
+	geometry::subdivideOpenCurve(points, depth, out, scratch);
 }
 
 void setupVAO(GLuint vaoID, GLuint vboID)
@@ -514,31 +1180,40 @@ GLFWwindow *initWindow()
 
 	glfwMakeContextCurrent(window);
 	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+	opengl::loadExtensions((GLADloadproc)glfwGetProcAddress);
 
 	glfwSwapInterval(1); // vsync
+
+	//the latency budget, one refresh
+	GLFWvidmode const *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	if (mode && mode->refreshRate > 0)
+		framePeriod = 1000.0 / mode->refreshRate;
 	glEnable(GL_MULTISAMPLE);
 	glEnable(GL_DEPTH_TEST);
-	// glEnable(GL_CULL_FACE);
-	// glCullFace(GL_BACK);
+	//surfaces wind counter-clockwise from outside, culling is switched off
+	//per frame for open ones
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_BACK);
+	glFrontFace(GL_CCW);
 
 	//Polygon fill mode
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
 	// setup callbacks
-	glfwSetFramebufferSizeCallback(window, setFrameBufferSize);
-	glfwSetKeyCallback(window, setKeyboard);
-	glfwSetCursorPosCallback(window, cursorPositionCallback);  //mouse pointer position
+	glfwSetFramebufferSizeCallback(window, queueFrameBufferSize);
+	glfwSetWindowRefreshCallback(window, refreshWindow);
+	glfwSetKeyCallback(window, queueKey);
+	glfwSetCursorPosCallback(window, queueCursorPosition);	   //mouse pointer position
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL); //keep mouse pointer visible
-	glfwSetMouseButtonCallback(window, mouseButtonCallback);   //mouse button control
+	glfwSetMouseButtonCallback(window, queueMouseButton);	   //mouse button control
 
 	return window;
 }
 
-int main()
+//Everything GL, on the render thread, until stopRendering
+void renderLoop(GLFWwindow *window, std::chrono::steady_clock::time_point startTime)
 {
-	GLFWwindow *window = initWindow();
-
 	auto vao_control = makeVertexArrayObject();
 	auto vbo_control = makeBufferObject();
 
@@ -546,7 +1221,10 @@ int main()
 	auto vbo_curve = makeBufferObject();
     auto vbo_vertices = makeBufferObject();
 
-    GLuint totalIndices = 0;
+	//fused pipeline index buffers, one per grid topology
+	opengl::IndexBufferCache gridIndexBuffers;
+
+    opengl::IndexedDraw curveDraw;
 
 	Vec3f viewPosition(0, 0, 3);
 	g_V = lookAtMatrix(viewPosition,	// eye position
@@ -555,18 +1233,38 @@ int main()
 	);
 	g_P = orthographicProjection(-1, 1, 1, -1, 0.001f, 10);
 
-	auto basicShader = createShaderProgram("../shaders/basic_vs.glsl",
+	//linked programs are reused across launches
+	opengl::ProgramBinaryCache programBinaries("shader_cache");
+
+	//programs are compiled on first use, the prepared ones all at once
+	opengl::ProgramQueue programs(&programBinaries);
+
+	//not drawn with, so never compiled
+	auto basicShader = createShaderProgram(programs,
+										   "../shaders/basic_vs.glsl",
 										   "../shaders/basic_fs.glsl");
+	(void)basicShader;
 
-	auto phongShader = createShaderProgram("../shaders/phong_vs.glsl",
-										   "../shaders/phong_fs.glsl");
+	//every phong permutation, compiled when a draw first needs it
+	opengl::ProgramVariants phongShaders("../shaders/phong_vs.glsl",
+										 "../shaders/phong_fs.glsl",
+										 programs);
+	phongShaders.prepare(phongFeatures(gpuRevolution));
 
-	assert(phongShader);
-    phongShader.use();
+	//the first light sits at the eye
+	Vec3f lightPositions[opengl::ShaderFeatures::MAX_LIGHTS] = {
+		viewPosition, {3.f, 3.f, 1.f}, {-3.f, -1.f, 2.f}, {0.f, -3.f, -3.f}};
 
-    setUniformVec3f(phongShader.uniformLocation("lightPosition"), viewPosition);
-    setUniformVec3f(phongShader.uniformLocation("viewPosition"), viewPosition);
+	//GPU revolution: the profile as a buffer texture, drawn with no attributes
+	//(core profile still needs a VAO bound to draw)
+	auto profileTexels = opengl::makeTextureBuffer(GL_R32F);
+	auto vao_revolve = makeVertexArrayObject();
+	auto maxProfileTexels = opengl::maxTextureBufferTexels();
+	std::size_t revolvedProfileSize = 0;
+	float revolvedProfileSweep = 1.f;
 
+	//built when the pipeline is first switched on
+	std::unique_ptr<opengl::FeedbackRevolution> feedbackRevolution;
 
 	setupVAO(vao_control.id(), vbo_control.id());
     setupVAO(vao_curve.id(), vbo_curve.id());
@@ -575,40 +1273,420 @@ int main()
 	controlPoints.push_back({0, -0.5, 0});
 	controlPoints.push_back({0.5, 0, 0});
 	controlPoints.push_back({0, 0.5, 0});
+	controlPointGrid.build(controlPoints);
 
 	Vec3f color_curve(0, 1, 1);
 	Vec3f color_control(1, 0, 0);
 
 	//Set to one shader program
-    opengl::Program *program = &phongShader;
+    opengl::Program const *program = nullptr;
+	opengl::ShaderFeatures programFeatures;
+
+	//decode range of the packed positions currently in vbo_vertices
+	opengl::PositionQuantization quantization;
 
 	glPointSize(10);
-	while (!glfwWindowShouldClose(window))
+	while (!stopRendering)
 	{
-		outCurve = subdivideOpenCurve(controlPoints);
+		//on demand, sleep until input arrives or something invalidates the frame
+		if (!continuousRendering)
+		{
+			profiling::TraceScope trace("frame", "wait for work");
+			waitForRenderWork();
+		}
+
+		std::chrono::steady_clock::time_point oldestInput;
+		bool hadInput = applyInputEvents(window, oldestInput);
+		updatePointer();
+
+		bool invalid = frameInvalid.exchange(false);
+		if (!continuousRendering && !invalid)
+			continue;
+
+		frameProfiler.beginFrame();
 
-		loadGeometryToGPU(controlPoints, vbo_control.id());
+		{
+			Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+			Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+			loadGeometryToGPU(controlPoints, vbo_control.id());
+		}
+
+		frameArena.reset();
+		auto heapAllocationsBefore = memory::heapAllocationCount();
+
+		//3 texels per profile point, longer profiles fall back to the CPU
+		bool revolveOnGPU = gpuRevolution &&
+							3 * geometry::subdividedOpenCurveSize(controlPoints.size(), depth) <= maxProfileTexels;
+
+		//whether the mesh drawn this frame closes at the poles, kept with the
+		//pipeline's rebuild state
+		bool closedSurface = false;
+
+		if (revolveOnGPU)
+		{
+			//only the profile is uploaded, the mesh and its normals never exist on the CPU
+			bool stale = !gpuProfile.valid || gpuProfile.depth != depth ||
+						 gpuProfile.controlPoints.size() != controlPoints.size();
+			if (!stale)
+			{
+				std::size_t first, last;
+				changedControlPoints(gpuProfile.controlPoints, controlPoints, first, last);
+				stale = first < last;
+			}
 
-		std::vector<Vec3f> triangleMesh = createTriangleMesh(outCurve);
+			if (stale)
+			{
+				subdivideOpenCurve(controlPoints, outCurve);
+				{
+					Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+					Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+					profileTexels.upload(outCurve.data(), sizeof(Vec3f) * outCurve.size());
+				}
+				revolvedProfileSize = outCurve.size();
+				revolvedProfileSweep = geometry::revolutionSweep(outCurve);
+
+				gpuProfile.valid = true;
+				gpuProfile.controlPoints = controlPoints;
+				gpuProfile.depth = depth;
+				gpuProfile.closed = geometry::revolvedSurfaceIsClosed(controlPoints);
+			}
 
-        geometry::OBJMesh meshData;
+			closedSurface = gpuProfile.closed;
+		}
+		else if (feedbackPipeline)
+		{
+			//the grid is captured into vbo_vertices, the fused pipeline starts over next time
+			fusedGrid.valid = false;
 
-        meshData.triangles = createIndices(triangleMesh);
-        meshData.vertices = triangleMesh;
+			if (!feedbackRevolution)
+			{
+				feedbackRevolution.reset(new opengl::FeedbackRevolution(opengl::makeFeedbackRevolution(
+					loadShaderStringFromFile("../shaders/chaikin_feedback_vs.glsl"),
+					loadShaderStringFromFile("../shaders/revolve_feedback_vs.glsl"))));
 
-        //cout<<"Size of triangles: "<<meshData.triangles.size()<<" Size of vertices: "<<meshData.vertices.size()<<endl;
+				assert(*feedbackRevolution);
+			}
 
-        auto normals = geometry::calculateVertexNormals(meshData.triangles, meshData.vertices);
+			//the passes only run again when their input changed
+			bool stale = !feedbackGrid.valid || feedbackGrid.depth != depth ||
+						 feedbackGrid.strips != triangleStrips ||
+						 feedbackGrid.controlPoints.size() != controlPoints.size();
+			if (!stale)
+			{
+				std::size_t first, last;
+				changedControlPoints(feedbackGrid.controlPoints, controlPoints, first, last);
+				stale = first < last;
+			}
 
+			if (stale)
+			{
+				//subdivision, revolution and normals all run in the feedback passes
+				std::size_t profileSize;
+				{
+					Profiler::CpuScope revolveTime(frameProfiler, Profiler::REVOLVE);
+					Profiler::GpuScope revolveGpuTime(frameProfiler, Profiler::REVOLVE);
+					profiling::TraceScope trace("mesh", "FeedbackRevolution::revolve");
+					profileSize = feedbackRevolution->revolve(controlPoints, depth, vbo_vertices, frameArena);
+				}
 
-        auto vboData = opengl::makeConsistentVertexNormalIndices(meshData, normals);
+				auto vertexCount = geometry::revolvedGridVertexCount(profileSize);
+				{
+					Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+					Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+					curveDraw = opengl::setup_vao_and_buffers(vao_curve, gridIndexBuffers, vbo_vertices,
+															  vertexCount, gridIndexRequest(profileSize));
+				}
 
-        totalIndices = opengl::setup_vao_and_buffers(vao_curve, vbo_curve, vbo_vertices, vboData);
+				feedbackGrid.valid = true;
+				feedbackGrid.controlPoints = controlPoints;
+				feedbackGrid.depth = depth;
+				feedbackGrid.strips = triangleStrips;
+				feedbackGrid.closed = geometry::revolvedSurfaceIsClosed(controlPoints);
+
+				if (compareFeedback)
+				{
+					auto comparison = opengl::compareWithCPU(controlPoints, depth, vbo_vertices, frameArena);
+
+					//only log when the result changes
+					static float lastPositionError = -1.f;
+					static float lastNormalError = -1.f;
+					if (comparison.maxPositionError != lastPositionError ||
+						comparison.maxNormalError != lastNormalError)
+					{
+						lastPositionError = comparison.maxPositionError;
+						lastNormalError = comparison.maxNormalError;
+						std::cout << "[Log] transform feedback vs CPU over " << comparison.vertexCount
+								  << " vertices: max position error " << comparison.maxPositionError
+								  << ", max normal error " << comparison.maxNormalError << '\n';
+					}
+				}
+			}
+
+			closedSurface = feedbackGrid.closed;
+		}
+		else if (fusedPipeline)
+		{
+			//the grid is written into vbo_vertices, the feedback pipeline starts over next time
+			feedbackGrid.valid = false;
+
+			//subdivide, revolve and compute normals block by block,
+			//writing straight into the mapped vertex buffer
+			auto profileSize = geometry::subdividedOpenCurveSize(controlPoints.size(), depth);
+			auto vertexCount = geometry::revolvedGridVertexCount(profileSize);
+
+			auto newQuantization = quantization;
+			if (packedVertices)
+			{
+				//bounds are known before the grid exists, so vertices pack as they are generated
+				Vec3f boundsMin, boundsMax;
+				geometry::revolvedGridBounds(controlPoints, boundsMin, boundsMax);
+				newQuantization = opengl::quantizationForBounds(boundsMin, boundsMax);
+			}
+
+			//with the same topology, only rows depending on moved control points change
+			bool sameTopology = fusedGrid.valid && fusedGrid.depth == depth &&
+								fusedGrid.controlPoints.size() == controlPoints.size();
+
+			std::size_t firstRow = 0;
+			std::size_t lastRow = profileSize;
+			if (sameTopology)
+			{
+				changedControlPoints(fusedGrid.controlPoints, controlPoints, firstRow, lastRow);
+				if (firstRow < lastRow)
+					geometry::revolvedGridRowsAffectedBy(controlPoints.size(), depth, firstRow, lastRow);
+				fusedGrid.volume.update(controlPoints, depth, firstRow, lastRow, frameArena);
+			}
+			else
+				fusedGrid.volume.compute(controlPoints, depth, frameArena);
+
+			//once per rebuild, a new sweep direction mirrors every row
+			auto sweep = fusedGrid.volume.sweep();
+
+			//and with the same packing and sweep only those rows are regenerated and uploaded
+			bool partial = sameTopology && fusedGrid.packed == packedVertices &&
+						   fusedGrid.strips == triangleStrips && fusedGrid.sweep == sweep &&
+						   (!packedVertices || newQuantization == quantization);
+			if (!partial)
+			{
+				firstRow = 0;
+				lastRow = profileSize;
+			}
+			quantization = newQuantization;
+
+			//a partial update stages only the changed rows, slice after slice
+			auto rowCount = lastRow - firstRow;
+			auto stagedIndex = [&](std::size_t index) {
+				return partial ? index / profileSize * rowCount + index % profileSize - firstRow : index;
+			};
+
+			//the grid is generated while the upload maps the buffer, so its
+			//revolve time (subdivision, normals and packing included) is also upload time.
+			//The fills are handed over by reference, a std::function holding
+			//their captures would allocate on every rebuild.
+			auto fillPacked = [&](opengl::PackedPosition *vertices, opengl::PackedNormal *normals) {
+				Profiler::CpuScope revolveTime(frameProfiler, Profiler::REVOLVE);
+				profiling::TraceScope trace("mesh", "revolveSubdividedCurveRange");
+				geometry::revolveSubdividedCurveRange(
+					controlPoints, depth, sweep, firstRow, lastRow,
+					[&](std::size_t index, Vec3f const &vertex, Vec3f const &normal) {
+						vertices[stagedIndex(index)] = opengl::packPosition(vertex, quantization);
+						normals[stagedIndex(index)] = opengl::packNormal(normal);
+					},
+					frameArena);
+			};
+			auto fill = [&](Vec3f *vertices, Vec3f *normals) {
+				Profiler::CpuScope revolveTime(frameProfiler, Profiler::REVOLVE);
+				profiling::TraceScope trace("mesh", "revolveSubdividedCurveRange");
+				geometry::revolveSubdividedCurveRange(
+					controlPoints, depth, sweep, firstRow, lastRow,
+					[&](std::size_t index, Vec3f const &vertex, Vec3f const &normal) {
+						vertices[stagedIndex(index)] = vertex;
+						normals[stagedIndex(index)] = normal;
+					},
+					frameArena);
+			};
+
+			std::size_t uploadedBytes = 0;
+			if (!partial)
+			{
+				Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+				Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+
+				auto indexBytesBefore = gridIndexBuffers.bytesUploaded();
+				auto vertexSize = packedVertices ? opengl::LayoutPackedVerticesNormals::vertexSize()
+												 : opengl::LayoutVerticesNormals::vertexSize();
+
+				if (packedVertices)
+					curveDraw = opengl::setup_vao_and_buffers(vao_curve, gridIndexBuffers, vbo_vertices,
+															  vertexCount, gridIndexRequest(profileSize), std::cref(fillPacked));
+				else
+					curveDraw = opengl::setup_vao_and_buffers(vao_curve, gridIndexBuffers, vbo_vertices,
+															  vertexCount, gridIndexRequest(profileSize), std::cref(fill));
+
+				uploadedBytes = vertexSize * vertexCount + gridIndexBuffers.bytesUploaded() - indexBytesBefore;
+			}
+			else if (firstRow < lastRow)
+			{
+				Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+				Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+
+				//the changed rows are one contiguous range in every slice
+				auto &rows = fusedGrid.rows;
+				rows.resize(geometry::REVOLUTION_SLICES);
+				for (unsigned int slice = 0; slice < geometry::REVOLUTION_SLICES; ++slice)
+				{
+					rows[slice].first = slice * profileSize + firstRow;
+					rows[slice].count = rowCount;
+				}
+
+				if (packedVertices)
+					uploadedBytes = opengl::update_vertex_ranges(vbo_vertices, vertexCount, rows, std::cref(fillPacked), frameArena);
+				else
+					uploadedBytes = opengl::update_vertex_ranges(vbo_vertices, vertexCount, rows, std::cref(fill), frameArena);
+			}
+
+			if (firstRow < lastRow)
+				fusedGrid.closed = geometry::revolvedSurfaceIsClosed(controlPoints);
+			closedSurface = fusedGrid.closed;
+
+			fusedGrid.valid = true;
+			fusedGrid.controlPoints = controlPoints;
+			fusedGrid.depth = depth;
+			fusedGrid.packed = packedVertices;
+			fusedGrid.strips = triangleStrips;
+			fusedGrid.sweep = sweep;
+
+			//report what each edit cost, whenever that changes
+			static std::size_t lastUploadedBytes = 0;
+			if (uploadedBytes > 0 && uploadedBytes != lastUploadedBytes)
+			{
+				lastUploadedBytes = uploadedBytes;
+				std::cout << "[Log] edit uploaded " << uploadedBytes << " bytes ("
+						  << (partial ? "rows " + std::to_string(firstRow) + '-' + std::to_string(lastRow)
+									  : std::string("full"))
+						  << " of " << profileSize << ")\n";
+			}
+		}
+		else
+		{
+			//the reference path rebuilds vao_curve, the fused and feedback ones start over next time
+			fusedGrid.valid = false;
+			feedbackGrid.valid = false;
+
+			subdivideOpenCurve(controlPoints, outCurve);
+			closedSurface = geometry::revolvedSurfaceIsClosed(controlPoints);
+
+			//storage is moved, not copied, from here to the upload
+			geometry::OBJMesh meshData;
+			{
+				Profiler::CpuScope revolveTime(frameProfiler, Profiler::REVOLVE);
+
+				std::vector<Vec3f> triangleMesh = createTriangleMesh(outCurve);
+
+				meshData.triangles = createIndices(triangleMesh);
+				meshData.vertices = std::move(triangleMesh);
+			}
+
+			geometry::Normals normals;
+			{
+				Profiler::CpuScope normalsTime(frameProfiler, Profiler::NORMALS);
+				profiling::TraceScope trace("mesh", "weld and vertex normals");
+
+				//merge the soup's duplicated corners so normals are smoothed across triangles
+				geometry::weldVertices(meshData, weldEpsilon);
+
+				normals = geometry::calculateVertexNormals(meshData.triangles, meshData.vertices);
+			}
+
+			opengl::VBOData_VerticesNormals vboData;
+			opengl::VBOData_PackedVerticesNormals packedData;
+			{
+				Profiler::CpuScope packingTime(frameProfiler, Profiler::VBO_PACKING);
+
+				vboData = opengl::makeConsistentVertexNormalIndices(std::move(meshData), std::move(normals));
+
+				if (optimizeIndices)
+				{
+					auto report = opengl::optimizeIndexOrder(vboData);
+
+					//only log when the mesh changed
+					static float lastACMR = -1.f;
+					if (report.acmrBefore != lastACMR)
+					{
+						lastACMR = report.acmrBefore;
+						std::cout << "[Log] ACMR " << report.acmrBefore << " -> "
+								  << report.acmrAfter << '\n';
+					}
+				}
+
+				if (packedVertices)
+				{
+					packedData = opengl::packVerticesNormals(std::move(vboData));
+					quantization = packedData.quantization;
+				}
+			}
+
+			Profiler::CpuScope uploadTime(frameProfiler, Profiler::UPLOAD);
+			Profiler::GpuScope uploadGpuTime(frameProfiler, Profiler::UPLOAD);
+			if (packedVertices)
+				curveDraw = opengl::setup_vao_and_buffers(vao_curve, vbo_curve, vbo_vertices, packedData, vertexStorage);
+			else
+				curveDraw = opengl::setup_vao_and_buffers(vao_curve, vbo_curve, vbo_vertices, vboData, vertexStorage);
+		}
+
+		//report whenever the number of heap allocations per rebuild changes
+		if (memory::heapAllocationCountingEnabled())
+		{
+			static std::size_t lastHeapAllocations = std::numeric_limits<std::size_t>::max();
+			std::size_t heapAllocations = memory::heapAllocationCount() - heapAllocationsBefore;
+			if (heapAllocations != lastHeapAllocations)
+			{
+				lastHeapAllocations = heapAllocations;
+				std::cout << "[Log] rebuild heap allocations: " << heapAllocations
+						  << " (arena " << frameArena.bytesUsed() << '/'
+						  << frameArena.capacity() << " bytes, "
+						  << frameArena.upstreamAllocations() << " chunks allocated)\n";
+			}
+		}
+
+		//only a closed surface hides its inside
+		if (backFaceCulling && closedSurface)
+			glEnable(GL_CULL_FACE);
+		else
+			glDisable(GL_CULL_FACE);
+
+		static int lastClosedSurface = -1;
+		if (int(closedSurface) != lastClosedSurface)
+		{
+			lastClosedSurface = closedSurface;
+			std::cout << "[Log] " << (closedSurface ? "closed surface" : "open surface, drawn double-sided")
+					  << '\n';
+		}
 
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+		//a permutation still building on the driver's threads is not waited for
+		//while the current program reads the same vertex data, it only shades
+		//differently until the frame after the new one is ready
+		auto features = phongFeatures(revolveOnGPU);
+		if (!program || !sameVertexInputs(features, programFeatures) || phongShaders.ready(features))
+		{
+			program = &phongShaders.program(features);
+			programFeatures = features;
+		}
+		else
+			invalidateFrame();
+		assert(*program);
 		program->use();
 
+		setUniformVec3f(program->uniformLocation("lightPosition"), lightCount, lightPositions[0].data());
+		setUniformVec3f(program->uniformLocation("viewPosition"), viewPosition);
+
+		if (!revolveOnGPU && packedVertices)
+		{
+			setUniformVec3f(program->uniformLocation("positionOffset"), quantization.offset);
+			setUniformVec3f(program->uniformLocation("positionScale"), quantization.scale);
+		}
 
 		setUniformMat4f(program->uniformLocation("model"), g_M, true);
 		setUniformMat4f(program->uniformLocation("view"), g_V, true);
@@ -620,30 +1698,127 @@ int main()
 
 
 
-		vao_curve.bind();
-        glDrawElements(GL_TRIANGLES,
-                           totalIndices,    // # of triangles * 3
-                           GL_UNSIGNED_INT, // type of indices
-                           (void *)0        // offset
-                           );
+		{
+			Profiler::CpuScope meshDrawTime(frameProfiler, Profiler::MESH_DRAW);
+			Profiler::GpuScope meshDrawGpuTime(frameProfiler, Profiler::MESH_DRAW);
+			profiling::TraceScope trace("frame", "draw mesh");
+
+			if (revolveOnGPU)
+			{
+				setUniform1i(program->uniformLocation("profile"), 0);
+				setUniform1f(program->uniformLocation("sweep"), revolvedProfileSweep);
+
+				//one instance per strip between neighbouring slices
+				profileTexels.bind(0);
+				vao_revolve.bind();
+				glDrawArraysInstanced(GL_TRIANGLE_STRIP,			   // type of drawing
+									  0,							   // first vertex
+									  2 * revolvedProfileSize,		   // 2 vertices per profile point
+									  geometry::REVOLUTION_SLICES	   // # of instances
+				);
+			}
+			else
+			{
+				vao_curve.bind();
+				opengl::drawIndexed(curveDraw);
+			}
+		}
 
 		glViewport(g_width / 2, 0, g_width / 2, g_height);
         //Control points
-		vao_control.bind();
-		glDrawArrays(GL_LINE_STRIP,		  // type of drawing (rendered to back buffer)
-					 0,					  // offset into buffer
-					 controlPoints.size() // number of vertices in buffer
-		);
+		{
+			Profiler::CpuScope controlPointDrawTime(frameProfiler, Profiler::CONTROL_POINT_DRAW);
+			Profiler::GpuScope controlPointDrawGpuTime(frameProfiler, Profiler::CONTROL_POINT_DRAW);
+			profiling::TraceScope trace("frame", "draw control points");
+
+			vao_control.bind();
+			glDrawArrays(GL_LINE_STRIP,		  // type of drawing (rendered to back buffer)
+						 0,					  // offset into buffer
+						 controlPoints.size() // number of vertices in buffer
+			);
+
+			glDrawArrays(GL_POINTS,			  // type of drawing (rendered to back buffer)
+						 0,					  // offset into buffer
+						 controlPoints.size() // number of vertices in buffer
+			);
+		}
+
+		//the swap waits for vsync, so a frame is timed up to it
+		frameProfiler.endFrame();
 
-		glDrawArrays(GL_POINTS,			  // type of drawing (rendered to back buffer)
-					 0,					  // offset into buffer
-					 controlPoints.size() // number of vertices in buffer
-		);
+		{
+			profiling::TraceScope trace("frame", "glfwSwapBuffers");
+			glfwSwapBuffers(window); // swaps back buffer to front for drawing to screen
+		}
+		profiling::traceFrameEnd();
+
+		//with vsync the swap returns about when the frame is scanned out
+		if (hadInput)
+			inputLatency.record(std::chrono::duration<double, std::milli>(
+									std::chrono::steady_clock::now() - oldestInput)
+									.count());
+
+		static bool firstFrame = true;
+		if (firstFrame)
+		{
+			firstFrame = false;
+			auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+			std::cout << "[Log] time to first frame: " << elapsed.count() << " ms ("
+					  << programBinaries.loaded() << " programs loaded from binaries, "
+					  << programBinaries.compiled() << " compiled)\n";
+		}
+
+		//with parallel compile, permutations the next key press may need
+		//build on the driver's threads in the meantime
+		if (opengl::extensions().parallelShaderCompile)
+		{
+			prepareNearbyVariants(phongShaders, features);
+			programs.issue();
+		}
+	}
+}
+
+//the render thread owns the context for its whole life, so the GL objects
+//in renderLoop are released while it is still current
+void runRenderThread(GLFWwindow *window, std::chrono::steady_clock::time_point startTime)
+{
+	profiling::setTraceThreadName("render");
+
+	glfwMakeContextCurrent(window);
+	renderLoop(window, startTime);
+	frameProfiler.release();
+	glfwMakeContextCurrent(nullptr);
+}
+
+int main()
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	GLFWwindow *window = initWindow();
 
-		glfwSwapBuffers(window); // swaps back buffer to front for drawing to screen
-		glfwPollEvents();		 // will process event queue and carry on
+	//hand the context to the render thread, this one only processes events,
+	//so input is picked up however long a frame takes
+	glfwMakeContextCurrent(nullptr);
+	std::thread renderThread(runRenderThread, window, startTime);
+
+	profiling::setTraceThreadName("main (events)");
+
+	while (!glfwWindowShouldClose(window))
+	{
+		profiling::TraceScope trace("input", "glfwWaitEvents");
+		glfwWaitEvents();
 	}
 
+	stopRendering = true;
+	wakeRenderThread();
+	renderThread.join();
+
+	printInputLatency();
+	printFrameStages();
+
+	//a capture still running is written with the frames it got
+	profiling::stopTrace();
+
 	// cleaup window, and glfw before exit
 	glfwDestroyWindow(window);
 	glfwTerminate();
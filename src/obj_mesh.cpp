@@ -11,6 +11,7 @@ std::vector<math::Vec3f>
 calculateTriangleNormals(std::vector<IndicesTriangle> const &indexTriangles,
                          std::vector<math::Vec3f> const &vertices) {
     std::vector<Vec3f> tmp;
+    tmp.reserve(indexTriangles.size()); // one normal per triangle
 
       //vertices holds the list of all vertices from the mesh
       //indexTriangles holds the indices of every triangle, we need the vertexID so we can do"
@@ -0,0 +1,144 @@
+#include "point_grid.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace math;
+
+namespace geometry {
+
+namespace {
+
+// the grid's extent, NDC
+constexpr float GRID_MIN = -1.f;
+constexpr float GRID_SIZE = 2.f;
+
+} // namespace
+
+constexpr long PointGrid::NO_POINT;
+
+PointGrid::PointGrid(unsigned int cellsPerSide)
+    : m_cellsPerSide(std::max(cellsPerSide, 1u)),
+      m_inverseCellSize(m_cellsPerSide / GRID_SIZE),
+      m_cells(std::size_t(m_cellsPerSide) * m_cellsPerSide) {}
+
+void PointGrid::build(Vertices const &points) {
+  for (auto &cell : m_cells) {
+    cell.clear();
+  }
+
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    m_cells[cellOf(points[i])].push_back(std::uint32_t(i));
+  }
+  m_size = points.size();
+}
+
+void PointGrid::insert(std::size_t index, Vec3f const &point) {
+  assert(index <= m_size);
+
+  // appending, the common case, renumbers nothing
+  if (index < m_size) {
+    for (auto &cell : m_cells) {
+      for (auto &stored : cell) {
+        if (stored >= index) {
+          ++stored;
+        }
+      }
+    }
+  }
+
+  m_cells[cellOf(point)].push_back(std::uint32_t(index));
+  ++m_size;
+}
+
+void PointGrid::erase(std::size_t index, Vec3f const &point) {
+  assert(index < m_size);
+
+  removeFromCell(cellOf(point), index);
+  --m_size;
+
+  if (index < m_size) {
+    for (auto &cell : m_cells) {
+      for (auto &stored : cell) {
+        if (stored > index) {
+          --stored;
+        }
+      }
+    }
+  }
+}
+
+void PointGrid::move(std::size_t index, Vec3f const &from, Vec3f const &to) {
+  auto fromCell = cellOf(from);
+  auto toCell = cellOf(to);
+  if (fromCell != toCell) {
+    removeFromCell(fromCell, index);
+    m_cells[toCell].push_back(std::uint32_t(index));
+  }
+}
+
+long PointGrid::nearest(Vertices const &points, float x, float y,
+                        float radius) const {
+  assert(points.size() == m_size);
+
+  // cell coordinates are monotonic in position, so the clamped box of cells
+  // covers every point within radius, border cells included
+  auto minX = cellCoordinate(x - radius);
+  auto maxX = cellCoordinate(x + radius);
+  auto minY = cellCoordinate(y - radius);
+  auto maxY = cellCoordinate(y + radius);
+
+  double const radius2 = double(radius) * radius;
+
+  long closest = NO_POINT;
+  double closestDistance2 = 0.0;
+  for (auto cellY = minY; cellY <= maxY; ++cellY) {
+    for (auto cellX = minX; cellX <= maxX; ++cellX) {
+      for (auto index : m_cells[std::size_t(cellY) * m_cellsPerSide + cellX]) {
+        double dx = x - points[index].x;
+        double dy = y - points[index].y;
+        double distance2 = dx * dx + dy * dy;
+
+        if (distance2 > radius2) {
+          continue;
+        }
+        if (closest == NO_POINT || distance2 < closestDistance2 ||
+            (distance2 == closestDistance2 && long(index) < closest)) {
+          closest = long(index);
+          closestDistance2 = distance2;
+        }
+      }
+    }
+  }
+  return closest;
+}
+
+std::size_t PointGrid::size() const { return m_size; }
+
+unsigned int PointGrid::cellCoordinate(float value) const {
+  auto cell = std::floor((value - GRID_MIN) * m_inverseCellSize);
+  // NaN ends up in cell 0
+  if (!(cell > 0.f)) {
+    return 0;
+  }
+  return cell >= m_cellsPerSide ? m_cellsPerSide - 1 : unsigned(cell);
+}
+
+std::size_t PointGrid::cellOf(Vec3f const &point) const {
+  return std::size_t(cellCoordinate(point.y)) * m_cellsPerSide +
+         cellCoordinate(point.x);
+}
+
+void PointGrid::removeFromCell(std::size_t cell, std::size_t index) {
+  auto &indices = m_cells[cell];
+  auto found = std::find(indices.begin(), indices.end(), std::uint32_t(index));
+  assert(found != indices.end());
+  if (found != indices.end()) {
+    // order within a cell does not matter
+    *found = indices.back();
+    indices.pop_back();
+  }
+}
+
+} // namespace geometry
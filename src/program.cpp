@@ -4,6 +4,8 @@
 #include <vector>
 #include <cassert>
 
+#include "gl_extensions.hpp"
+
 namespace opengl {
 
 Program::Program(GLuint programID) : m_object(programID) {}
@@ -71,6 +73,17 @@ Program makeProgram(std::string const &vertexShaderSource,
 }
 
 Program makeProgram(Shader const &vertexShader, Shader const &fragmentShader) {
+  auto program = makeProgramDeferred(vertexShader, fragmentShader);
+
+  if (!program || !checkLinkStatus(program.id())) {
+    return Program(Program::INVALID_ID);
+  }
+
+  return program;
+}
+
+Program makeProgramDeferred(Shader const &vertexShader,
+                            Shader const &fragmentShader) {
   if (!vertexShader.isValid() || !fragmentShader.isValid()) {
     return Program(Program::INVALID_ID);
   }
@@ -88,16 +101,18 @@ Program makeProgram(Shader const &vertexShader, Shader const &fragmentShader) {
   glAttachShader(program.id(), vertexShader.id());
   glAttachShader(program.id(), fragmentShader.id());
 
+  // keep the binary around for the program binary cache
+  if (extensions().programBinary) {
+    extensions().programParameteri(program.id(),
+                                   PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+
   glLinkProgram(program.id());
 
   // detach so shaders may be deallocated properly
   glDetachShader(program.id(), vertexShader.id());
   glDetachShader(program.id(), fragmentShader.id());
 
-  if (!checkLinkStatus(program.id())) {
-    return Program(Program::INVALID_ID);
-  }
-
   return program;
 }
 
@@ -136,6 +151,92 @@ Program makeProgram(Shader const &vertexShader, Shader const &geometryShader,
   return program;
 }
 
+Program makeTransformFeedbackProgram(std::string const &vertexShaderSource,
+                                     std::vector<std::string> const &varyings) {
+  auto vs = makeShader(vertexShaderSource, Shader::VERTEX);
+  if (!vs.isValid()) {
+    std::cerr << "Failed to compile vertex shader\n";
+    return Program(Program::INVALID_ID);
+  }
+  return makeTransformFeedbackProgram(vs, varyings);
+}
+
+Program makeTransformFeedbackProgram(Shader const &vertexShader,
+                                     std::vector<std::string> const &varyings) {
+  if (!vertexShader.isValid() || vertexShader.type() != Shader::VERTEX) {
+    return Program(Program::INVALID_ID);
+  }
+
+  Program program(glCreateProgram());
+  if (!program) {
+    return Program(Program::INVALID_ID);
+  }
+
+  glAttachShader(program.id(), vertexShader.id());
+
+  // captured outputs must be named before linking
+  std::vector<GLchar const *> names;
+  names.reserve(varyings.size());
+  for (auto const &varying : varyings) {
+    names.push_back(varying.c_str());
+  }
+  glTransformFeedbackVaryings(program.id(), GLsizei(names.size()),
+                              names.data(), GL_INTERLEAVED_ATTRIBS);
+
+  glLinkProgram(program.id());
+
+  glDetachShader(program.id(), vertexShader.id());
+
+  if (!checkLinkStatus(program.id())) {
+    return Program(Program::INVALID_ID);
+  }
+
+  return program;
+}
+
+Program makeProgramFromBinary(GLenum binaryFormat, void const *binary,
+                              GLsizei length) {
+  if (!extensions().programBinary || !binary || length <= 0) {
+    return Program(Program::INVALID_ID);
+  }
+
+  Program program(glCreateProgram());
+  if (!program) {
+    return Program(Program::INVALID_ID);
+  }
+
+  extensions().loadProgramBinary(program.id(), binaryFormat, binary, length);
+
+  // a stale binary is expected, so no error log
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program.id(), GL_LINK_STATUS, &linked);
+  if (!linked) {
+    return Program(Program::INVALID_ID);
+  }
+
+  return program;
+}
+
+bool getProgramBinary(Program const &program, GLenum &binaryFormat,
+                      std::vector<char> &binary) {
+  if (!program || !extensions().programBinary) {
+    return false;
+  }
+
+  GLint length = 0;
+  glGetProgramiv(program.id(), PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return false;
+  }
+
+  binary.resize(length);
+  GLsizei written = 0;
+  extensions().getProgramBinary(program.id(), length, &written, &binaryFormat,
+                                binary.data());
+  binary.resize(written);
+  return written > 0;
+}
+
 bool isValidProgramID(GLuint id) { return id != Program::INVALID_ID; }
 
 bool checkLinkStatus(GLuint programID) {
@@ -175,6 +276,10 @@ void setUniform1f(GLuint uniformLocation, float value) {
   glUniform1f(uniformLocation, value);
 }
 
+void setUniform1i(GLuint uniformLocation, int value) {
+  glUniform1i(uniformLocation, value);
+}
+
 template <> void release_object<Program>(GLuint &name) {
   glDeleteProgram(name);
 }
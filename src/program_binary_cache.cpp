@@ -0,0 +1,224 @@
+#include "program_binary_cache.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "gl_extensions.hpp"
+
+namespace opengl {
+
+namespace {
+
+// identifies a cache file and the layout of its header
+constexpr char MAGIC[4] = {'C', 'M', 'P', 'B'};
+constexpr std::uint32_t FILE_VERSION = 1;
+
+struct BinaryHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t key;
+  std::uint32_t format;
+  std::uint32_t length;
+};
+
+// 64 bit FNV-1a, continuing from hash
+std::uint64_t fnv1a(std::string const &text,
+                    std::uint64_t hash = 14695981039346656037ull) {
+  for (unsigned char c : text) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+std::string glString(GLenum name) {
+  auto value = reinterpret_cast<char const *>(glGetString(name));
+  return value ? value : "";
+}
+
+bool makeDirectory(std::string const &directory) {
+#ifdef _WIN32
+  return _mkdir(directory.c_str()) == 0 || errno == EEXIST;
+#else
+  return mkdir(directory.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+int processID() {
+#ifdef _WIN32
+  return _getpid();
+#else
+  return int(getpid());
+#endif
+}
+
+// replaces to with from in one step, readers see either file whole
+bool replaceFile(std::string const &from, std::string const &to) {
+#ifdef _WIN32
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+  return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+bool readBinary(std::string const &path, std::uint64_t key, GLenum &format,
+                std::vector<char> &binary) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+
+  auto fileSize = std::uint64_t(file.tellg());
+  file.seekg(0);
+
+  BinaryHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version != FILE_VERSION || header.key != key) {
+    return false;
+  }
+
+  // the length is only trusted if it is exactly what follows the header
+  if (fileSize < sizeof(header) || header.length != fileSize - sizeof(header)) {
+    return false;
+  }
+
+  format = header.format;
+  binary.resize(header.length);
+  if (!file.read(binary.data(), binary.size())) {
+    binary.clear();
+    return false;
+  }
+  return true;
+}
+
+void writeBinary(std::string const &path, std::uint64_t key, GLenum format,
+                 std::vector<char> const &binary) {
+  BinaryHeader header;
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = FILE_VERSION;
+  header.key = key;
+  header.format = format;
+  header.length = std::uint32_t(binary.size());
+
+  // Other viewers may share the cache directory: the binary is written to a
+  // file of this process's own and renamed over path when complete, so
+  // nobody reads a partly written one.
+  static std::atomic<unsigned int> writes(0);
+  std::ostringstream temporary;
+  temporary << path << '.' << processID() << '.' << writes++ << ".tmp";
+
+  {
+    std::ofstream file(temporary.str(), std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    file.write(binary.data(), binary.size());
+    file.close();
+
+    if (!file) {
+      std::cerr << "[Error] could not write program binary " << path << '\n';
+      std::remove(temporary.str().c_str());
+      return;
+    }
+  }
+
+  if (!replaceFile(temporary.str(), path)) {
+    std::cerr << "[Error] could not replace program binary " << path << '\n';
+    std::remove(temporary.str().c_str());
+  }
+}
+
+} // namespace
+
+ProgramBinaryCache::ProgramBinaryCache(std::string const &directory)
+    : m_directory(directory),
+      m_driver(glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' +
+               glString(GL_VERSION)) {
+  if (extensions().programBinary && !makeDirectory(m_directory)) {
+    std::cerr << "[Error] could not create program cache directory "
+              << m_directory << '\n';
+  }
+}
+
+Program ProgramBinaryCache::program(std::string const &vertexShaderSource,
+                                    std::string const &fragmentShaderSource) {
+  auto program = load(vertexShaderSource, fragmentShaderSource);
+  if (program) {
+    return program;
+  }
+
+  program = makeProgram(vertexShaderSource, fragmentShaderSource);
+  save(vertexShaderSource, fragmentShaderSource, program);
+  return program;
+}
+
+Program ProgramBinaryCache::load(std::string const &vertexShaderSource,
+                                 std::string const &fragmentShaderSource) {
+  auto programKey = key(vertexShaderSource, fragmentShaderSource);
+  auto programPath = path(programKey);
+
+  GLenum format = 0;
+  std::vector<char> binary;
+  bool found = extensions().programBinary &&
+               readBinary(programPath, programKey, format, binary);
+
+  // no binary makes an invalid program
+  auto program =
+      makeProgramFromBinary(format, binary.data(), GLsizei(binary.size()));
+  if (program) {
+    ++m_loaded;
+  } else if (found) {
+    std::cout << "[Log] stale program binary " << programPath
+              << ", compiling\n";
+  }
+  return program;
+}
+
+void ProgramBinaryCache::save(std::string const &vertexShaderSource,
+                              std::string const &fragmentShaderSource,
+                              Program const &program) {
+  ++m_compiled;
+
+  GLenum format = 0;
+  std::vector<char> binary;
+  if (program && getProgramBinary(program, format, binary)) {
+    auto programKey = key(vertexShaderSource, fragmentShaderSource);
+    writeBinary(path(programKey), programKey, format, binary);
+  }
+}
+
+std::size_t ProgramBinaryCache::loaded() const { return m_loaded; }
+
+std::size_t ProgramBinaryCache::compiled() const { return m_compiled; }
+
+std::uint64_t
+ProgramBinaryCache::key(std::string const &vertexShaderSource,
+                        std::string const &fragmentShaderSource) const {
+  // separators keep e.g. ("ab", "c") and ("a", "bc") apart
+  auto hash = fnv1a(m_driver);
+  hash = fnv1a(std::string(1, '\0') + vertexShaderSource, hash);
+  hash = fnv1a(std::string(1, '\0') + fragmentShaderSource, hash);
+  return hash;
+}
+
+std::string ProgramBinaryCache::path(std::uint64_t key) const {
+  std::ostringstream s;
+  s << m_directory << '/' << std::hex << key << ".bin";
+  return s.str();
+}
+
+} // namespace opengl
@@ -0,0 +1,136 @@
+#include "program_queue.hpp"
+
+#include "gl_extensions.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <utility>
+
+namespace opengl {
+
+ProgramQueue::ProgramQueue(ProgramBinaryCache *binaries)
+    : m_binaries(binaries) {}
+
+ProgramQueue::Handle
+ProgramQueue::add(std::string const &name,
+                  std::string const &vertexShaderSource,
+                  std::string const &fragmentShaderSource) {
+  m_sources.push_back(Sources{name, vertexShaderSource, fragmentShaderSource,
+                              BuildState::Added});
+  return m_sources.size() - 1;
+}
+
+void ProgramQueue::prepare(Handle handle) {
+  assert(handle < m_sources.size());
+  if (m_sources[handle].state == BuildState::Added) {
+    m_sources[handle].state = BuildState::Prepared;
+  }
+}
+
+void ProgramQueue::issue() {
+  for (Handle handle = 0; handle < m_sources.size(); ++handle) {
+    if (m_sources[handle].state == BuildState::Prepared) {
+      issue(handle);
+    }
+  }
+}
+
+bool ProgramQueue::ready(Handle handle) {
+  assert(handle < m_sources.size());
+
+  auto &sources = m_sources[handle];
+  if (sources.state != BuildState::Done) {
+    prepare(handle);
+    issue();
+  }
+  if (sources.state == BuildState::Done ||
+      !extensions().parallelShaderCompile) {
+    return true;
+  }
+
+  // the link completes after the compiles, a program that could not even be
+  // created fails in finish() without waiting
+  auto const &built = m_pending.find(handle)->second;
+  if (!built.program) {
+    return true;
+  }
+
+  GLint completed = GL_FALSE;
+  glGetProgramiv(built.program.id(), COMPLETION_STATUS, &completed);
+  return completed == GL_TRUE;
+}
+
+Program const &ProgramQueue::program(Handle handle) {
+  assert(handle < m_sources.size());
+
+  auto &sources = m_sources[handle];
+  if (sources.state != BuildState::Done) {
+    prepare(handle);
+    issue();
+    finish(handle);
+  }
+
+  return m_programs.find(handle)->second;
+}
+
+std::size_t ProgramQueue::size() const { return m_sources.size(); }
+
+void ProgramQueue::issue(Handle handle) {
+  auto &sources = m_sources[handle];
+  std::cout << "[Log] building program " << sources.name << '\n';
+
+  if (m_binaries) {
+    auto program = m_binaries->load(sources.vertexShader, sources.fragmentShader);
+    if (program) {
+      m_programs.emplace(handle, std::move(program));
+      sources.state = BuildState::Done;
+      return;
+    }
+  }
+
+  auto vertexShader = makeShaderDeferred(sources.vertexShader, Shader::VERTEX);
+  auto fragmentShader =
+      makeShaderDeferred(sources.fragmentShader, Shader::FRAGMENT);
+  auto program = makeProgramDeferred(vertexShader, fragmentShader);
+
+  m_pending.emplace(handle, Pending{std::move(vertexShader),
+                                    std::move(fragmentShader),
+                                    std::move(program)});
+  sources.state = BuildState::Issued;
+}
+
+void ProgramQueue::finish(Handle handle) {
+  auto &sources = m_sources[handle];
+  if (sources.state == BuildState::Done) {
+    return;
+  }
+
+  auto pending = m_pending.find(handle);
+  assert(pending != m_pending.end());
+
+  // blocks until the driver is done, then reports the compile errors, which
+  // explain a failed link better than the link log
+  auto &built = pending->second;
+  bool vertexCompiled =
+      built.vertexShader && checkCompileStatus(built.vertexShader.id());
+  bool fragmentCompiled =
+      built.fragmentShader && checkCompileStatus(built.fragmentShader.id());
+  bool linked = vertexCompiled && fragmentCompiled && built.program &&
+                checkLinkStatus(built.program.id());
+
+  if (!linked) {
+    std::cerr << "[Error] failed to build program " << sources.name << '\n';
+    m_programs.emplace(handle, Program(Program::INVALID_ID));
+  } else {
+    if (m_binaries) {
+      m_binaries->save(sources.vertexShader, sources.fragmentShader,
+                       built.program);
+    }
+    m_programs.emplace(handle, std::move(built.program));
+  }
+
+  m_pending.erase(pending);
+  sources.state = BuildState::Done;
+}
+
+} // namespace opengl
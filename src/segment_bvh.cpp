@@ -0,0 +1,146 @@
+#include "segment_bvh.hpp"
+
+#include <algorithm>
+
+using namespace math;
+
+namespace geometry {
+
+namespace {
+
+// segments per leaf
+constexpr std::uint32_t LEAF_SIZE = 4;
+
+// squared distance from (x, y) to the box, 0 inside it
+template <typename Node> float boxDistance2(Node const &node, float x, float y) {
+  float dx = std::max(std::max(node.minX - x, x - node.maxX), 0.f);
+  float dy = std::max(std::max(node.minY - y, y - node.maxY), 0.f);
+  return dx * dx + dy * dy;
+}
+
+} // namespace
+
+void SegmentBVH::build(Vertices const &polyline) {
+  m_points = polyline;
+  m_nodes.clear();
+
+  if (segmentCount() == 0) {
+    return;
+  }
+
+  // a full binary tree over ceil(n / LEAF_SIZE) leaves has fewer than twice
+  // as many nodes
+  m_nodes.reserve(2 * (segmentCount() / LEAF_SIZE + 1));
+  m_nodes.resize(1);
+  buildNode(0, 0, std::uint32_t(segmentCount()));
+}
+
+bool SegmentBVH::nearest(float x, float y, float radius,
+                         SegmentHit &hit) const {
+  if (m_nodes.empty()) {
+    return false;
+  }
+
+  SegmentHit best;
+  best.distance2 = radius * radius;
+  bool found = false;
+  nearestIn(0, x, y, best, found);
+
+  if (found) {
+    hit = best;
+  }
+  return found;
+}
+
+std::size_t SegmentBVH::segmentCount() const {
+  return m_points.size() < 2 ? 0 : m_points.size() - 1;
+}
+
+void SegmentBVH::buildNode(std::uint32_t node, std::uint32_t first,
+                           std::uint32_t count) {
+  if (count <= LEAF_SIZE) {
+    Node leaf;
+    leaf.minX = leaf.maxX = m_points[first].x;
+    leaf.minY = leaf.maxY = m_points[first].y;
+    for (auto p = first + 1; p <= first + count; ++p) {
+      leaf.minX = std::min(leaf.minX, m_points[p].x);
+      leaf.minY = std::min(leaf.minY, m_points[p].y);
+      leaf.maxX = std::max(leaf.maxX, m_points[p].x);
+      leaf.maxY = std::max(leaf.maxY, m_points[p].y);
+    }
+    leaf.first = first;
+    leaf.count = count;
+    m_nodes[node] = leaf;
+    return;
+  }
+
+  // indices only, building the children may reallocate m_nodes
+  auto children = std::uint32_t(m_nodes.size());
+  m_nodes.resize(m_nodes.size() + 2);
+
+  auto half = count / 2;
+  buildNode(children, first, half);
+  buildNode(children + 1, first + half, count - half);
+
+  auto const &left = m_nodes[children];
+  auto const &right = m_nodes[children + 1];
+  Node inner;
+  inner.minX = std::min(left.minX, right.minX);
+  inner.minY = std::min(left.minY, right.minY);
+  inner.maxX = std::max(left.maxX, right.maxX);
+  inner.maxY = std::max(left.maxY, right.maxY);
+  inner.first = children;
+  inner.count = 0;
+  m_nodes[node] = inner;
+}
+
+void SegmentBVH::nearestIn(std::uint32_t node, float x, float y,
+                           SegmentHit &best, bool &found) const {
+  auto const &current = m_nodes[node];
+
+  if (current.count > 0) {
+    for (auto s = current.first; s < current.first + current.count; ++s) {
+      auto const &a = m_points[s];
+      auto const &b = m_points[s + 1];
+
+      // projection onto the segment, clamped to its ends
+      float dx = b.x - a.x;
+      float dy = b.y - a.y;
+      float length2 = dx * dx + dy * dy;
+      float t = length2 > 0.f ? ((x - a.x) * dx + (y - a.y) * dy) / length2 : 0.f;
+      t = std::min(std::max(t, 0.f), 1.f);
+
+      float px = x - (a.x + t * dx);
+      float py = y - (a.y + t * dy);
+      float distance2 = px * px + py * py;
+
+      if (distance2 <= best.distance2 && (!found || distance2 < best.distance2)) {
+        best.segment = s;
+        best.t = t;
+        best.point = lerp(a, b, t);
+        best.distance2 = distance2;
+        found = true;
+      }
+    }
+    return;
+  }
+
+  // the closer child first, so the further one is more likely skipped
+  auto left = current.first;
+  auto right = current.first + 1;
+  float leftDistance2 = boxDistance2(m_nodes[left], x, y);
+  float rightDistance2 = boxDistance2(m_nodes[right], x, y);
+  if (rightDistance2 < leftDistance2) {
+    std::swap(left, right);
+    std::swap(leftDistance2, rightDistance2);
+  }
+
+  if (leftDistance2 <= best.distance2) {
+    nearestIn(left, x, y, best, found);
+  }
+  if (rightDistance2 <= best.distance2) {
+    nearestIn(right, x, y, best, found);
+  }
+}
+
+} // namespace geometry
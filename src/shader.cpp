@@ -50,6 +50,17 @@ bool checkCompileStatus(GLuint shaderID) {
 }
 
 Shader makeShader(std::string const &shaderCode, Shader::Type shaderTypeEnum) {
+  auto shader = makeShaderDeferred(shaderCode, shaderTypeEnum);
+
+  if (!shader || !checkCompileStatus(shader.id())) {
+    return Shader(Shader::INVALID_ID, Shader::INVALID);
+  }
+
+  return shader;
+}
+
+Shader makeShaderDeferred(std::string const &shaderCode,
+                          Shader::Type shaderTypeEnum) {
   auto type = enumToShaderType(shaderTypeEnum);
   if (!isValidShaderType(type)) {
     return Shader(Shader::INVALID_ID, Shader::INVALID);
@@ -68,10 +79,6 @@ Shader makeShader(std::string const &shaderCode, Shader::Type shaderTypeEnum) {
 
   glCompileShader(shader.id());
 
-  if (!checkCompileStatus(shader.id())) {
-    return Shader(Shader::INVALID_ID, Shader::INVALID);
-  }
-
   return shader;
 }
 
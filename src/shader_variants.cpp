@@ -0,0 +1,91 @@
+#include "shader_variants.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+#include "shader_file_io.hpp"
+
+namespace opengl {
+
+unsigned ShaderFeatures::key() const {
+  return (flags & 0xFFu) | (lightCount << 8);
+}
+
+std::string ShaderFeatures::defines() const {
+  std::ostringstream s;
+  if (flags & FLAT_SHADING) {
+    s << "#define FLAT_SHADING\n";
+  }
+  if (flags & PACKED_VERTICES) {
+    s << "#define PACKED_VERTICES\n";
+  }
+  if (flags & REVOLVED_PROFILE) {
+    s << "#define REVOLVED_PROFILE\n";
+  }
+  s << "#define LIGHT_COUNT " << lightCount << '\n';
+  return s.str();
+}
+
+std::string injectDefines(std::string const &source,
+                          std::string const &defines) {
+  auto version = source.find("#version");
+  if (version == std::string::npos) {
+    return defines + "#line 1\n" + source;
+  }
+
+  auto lineEnd = source.find('\n', version);
+  if (lineEnd == std::string::npos) {
+    return source + '\n' + defines;
+  }
+
+  // the line after #version keeps its number
+  auto nextLine = std::count(source.begin(), source.begin() + lineEnd, '\n') + 2;
+
+  std::ostringstream s;
+  s << source.substr(0, lineEnd + 1) << defines << "#line " << nextLine
+    << '\n'
+    << source.substr(lineEnd + 1);
+  return s.str();
+}
+
+ProgramVariants::ProgramVariants(std::string const &vertexShaderFile,
+                                 std::string const &fragmentShaderFile,
+                                 ProgramQueue &queue)
+    : m_vertexShaderFile(vertexShaderFile),
+      m_fragmentShaderFile(fragmentShaderFile),
+      m_vertexSource(loadShaderStringFromFile(vertexShaderFile)),
+      m_fragmentSource(loadShaderStringFromFile(fragmentShaderFile)),
+      m_queue(queue) {}
+
+void ProgramVariants::prepare(ShaderFeatures const &features) {
+  m_queue.prepare(handle(features));
+}
+
+bool ProgramVariants::ready(ShaderFeatures const &features) {
+  return m_queue.ready(handle(features));
+}
+
+Program const &ProgramVariants::program(ShaderFeatures const &features) {
+  return m_queue.program(handle(features));
+}
+
+std::size_t ProgramVariants::size() const { return m_handles.size(); }
+
+ProgramQueue::Handle ProgramVariants::handle(ShaderFeatures const &features) {
+  auto found = m_handles.find(features.key());
+  if (found != m_handles.end()) {
+    return found->second;
+  }
+
+  std::ostringstream name;
+  name << m_vertexShaderFile << ' ' << m_fragmentShaderFile
+       << " with features 0x" << std::hex << features.key();
+
+  auto defines = features.defines();
+  auto added = m_queue.add(name.str(), injectDefines(m_vertexSource, defines),
+                           injectDefines(m_fragmentSource, defines));
+  m_handles.emplace(features.key(), added);
+  return added;
+}
+
+} // namespace opengl
@@ -0,0 +1,318 @@
+#include "surface_of_revolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "vertex_cache.hpp"
+
+using namespace math;
+
+namespace geometry {
+
+namespace {
+
+// Grid cells per index band. Two rows of (width + 1) vertices take half the
+// post-transform cache the index optimizer assumes (opengl::VERTEX_CACHE_SIZE),
+// so bands still hit in caches half that size: with 32 entries, filling the
+// whole cache (width 15) saves only ~6% ACMR but doubles it on a 16 entry one.
+constexpr std::size_t GRID_BAND_WIDTH = opengl::VERTEX_CACHE_SIZE / 4 - 1;
+
+// Profile segments subdivided at a time when only the swept volume is
+// needed. Every volume is summed per block of this many segments, and the
+// blocks are summed in order, so however a profile is produced its volume
+// comes out exactly the same.
+constexpr std::size_t SWEEP_BLOCK_SIZE = 1024;
+
+std::size_t sweepBlockCount(std::size_t profileSize) {
+  return profileSize < 2 ? 0 : (profileSize - 2) / SWEEP_BLOCK_SIZE + 1;
+}
+
+// adds the segments of points[0, count) to volume, in order
+void accumulateSweptVolume(Vec3f const *points, std::size_t count,
+                           double &volume) {
+  // x^2 is linear in neither end, so integrate each segment exactly:
+  // integral of x^2 dy = dy * (x0^2 + x0 x1 + x1^2) / 3
+  for (std::size_t i = 0; i + 1 < count; ++i) {
+    double x0 = points[i].x;
+    double x1 = points[i + 1].x;
+    double dy = double(points[i + 1].y) - points[i].y;
+    volume += dy * (x0 * x0 + x0 * x1 + x1 * x1);
+  }
+}
+
+float sweepForVolume(double volume) { return volume > 0.0 ? -1.f : 1.f; }
+
+// volume of the segments in block `block` of the subdivided profile, points
+// needs room for SWEEP_BLOCK_SIZE + 1 of them (blocks share their end points)
+double subdividedBlockVolume(Vertices const &controlPoints, int depth,
+                             std::size_t block, Vec3f *points,
+                             SubdivisionScratch &scratch) {
+  auto profileSize = subdividedOpenCurveSize(controlPoints.size(), depth);
+  auto first = block * SWEEP_BLOCK_SIZE;
+  auto last = std::min(first + SWEEP_BLOCK_SIZE + 1, profileSize);
+  subdivideOpenCurveRange(controlPoints, depth, first, last, points, scratch);
+
+  double volume = 0.0;
+  accumulateSweptVolume(points, last - first, volume);
+  return volume;
+}
+
+} // namespace
+
+std::size_t revolvedGridVertexCount(std::size_t profileSize) {
+  return profileSize < 2 ? 0 : REVOLUTION_SLICES * profileSize;
+}
+
+std::size_t revolvedGridIndexCount(std::size_t profileSize) {
+  return profileSize < 2 ? 0 : REVOLUTION_SLICES * (profileSize - 1) * 6;
+}
+
+std::size_t revolvedGridStripIndexCount(std::size_t profileSize) {
+  // 2 * profileSize + 1 per strip, a restart index between strips
+  return profileSize < 2 ? 0 : REVOLUTION_SLICES * (2 * profileSize + 2) - 1;
+}
+
+namespace revolution_detail {
+
+std::array<SliceRotation, REVOLUTION_SLICES> sliceRotations(float sweep) {
+  constexpr float degreesToRadians = M_PI / 180.f;
+
+  std::array<SliceRotation, REVOLUTION_SLICES> rotations;
+  for (unsigned int slice = 0; slice < REVOLUTION_SLICES; ++slice) {
+    float angle = slice * REVOLUTION_STEP_DEGREES * degreesToRadians;
+    rotations[slice].cosTheta = std::cos(angle);
+    // sweeping the other way only mirrors the angle
+    rotations[slice].sinTheta = sweep * std::sin(angle);
+  }
+  return rotations;
+}
+
+} // namespace revolution_detail
+
+float revolutionSweep(Vertices const &profile) {
+  double volume = 0.0;
+  for (std::size_t block = 0; block < sweepBlockCount(profile.size());
+       ++block) {
+    auto first = block * SWEEP_BLOCK_SIZE;
+    auto last = std::min(first + SWEEP_BLOCK_SIZE + 1, profile.size());
+
+    double blockVolume = 0.0;
+    accumulateSweptVolume(profile.data() + first, last - first, blockVolume);
+    volume += blockVolume;
+  }
+  return sweepForVolume(volume);
+}
+
+float revolutionSweep(Vertices const &controlPoints, int depth,
+                      memory::FrameArena &arena) {
+  auto profileSize = subdividedOpenCurveSize(controlPoints.size(), depth);
+
+  SubdivisionScratch scratch(arena);
+  memory::ArenaVector<Vec3f> points(SWEEP_BLOCK_SIZE + 1,
+                                    memory::ArenaAllocator<Vec3f>(arena));
+
+  double volume = 0.0;
+  for (std::size_t block = 0; block < sweepBlockCount(profileSize); ++block) {
+    volume += subdividedBlockVolume(controlPoints, depth, block, points.data(),
+                                    scratch);
+  }
+  return sweepForVolume(volume);
+}
+
+void SweptVolume::compute(Vertices const &controlPoints, int depth,
+                          memory::FrameArena &arena) {
+  auto profileSize = subdividedOpenCurveSize(controlPoints.size(), depth);
+  m_blocks.resize(sweepBlockCount(profileSize));
+  update(controlPoints, depth, 0, profileSize, arena);
+}
+
+void SweptVolume::update(Vertices const &controlPoints, int depth,
+                         std::size_t first, std::size_t last,
+                         memory::FrameArena &arena) {
+  if (first >= last || m_blocks.empty()) {
+    return;
+  }
+
+  // segment i joins rows i and i + 1, so rows [first, last) move segments
+  // first - 1 to last - 1
+  auto firstBlock = (first > 0 ? first - 1 : 0) / SWEEP_BLOCK_SIZE;
+  auto lastBlock =
+      std::min((last - 1) / SWEEP_BLOCK_SIZE + 1, m_blocks.size());
+
+  SubdivisionScratch scratch(arena);
+  memory::ArenaVector<Vec3f> points(SWEEP_BLOCK_SIZE + 1,
+                                    memory::ArenaAllocator<Vec3f>(arena));
+  for (auto block = firstBlock; block < lastBlock; ++block) {
+    m_blocks[block] = subdividedBlockVolume(controlPoints, depth, block,
+                                            points.data(), scratch);
+  }
+}
+
+double SweptVolume::volume() const {
+  double volume = 0.0;
+  for (auto blockVolume : m_blocks) {
+    volume += blockVolume;
+  }
+  return volume;
+}
+
+float SweptVolume::sweep() const { return sweepForVolume(volume()); }
+
+bool revolvedSurfaceIsClosed(Vertices const &controlPoints) {
+  auto count = controlPoints.size();
+  if (count < 2) {
+    return false;
+  }
+
+  float extent = 0.f;
+  for (auto const &point : controlPoints) {
+    extent = std::max(extent, std::max(std::abs(point.x), std::abs(point.y)));
+  }
+
+  // pole triangles narrower than this fraction of the profile are treated as
+  // closing the surface
+  float const tolerance = 1e-4f * extent;
+  auto onAxis = [tolerance](Vec3f const &point) {
+    return std::abs(point.x) <= tolerance;
+  };
+
+  return onAxis(controlPoints[0]) && onAxis(controlPoints[1]) &&
+         onAxis(controlPoints[count - 2]) && onAxis(controlPoints[count - 1]);
+}
+
+void revolveSubdividedCurve(Vertices const &controlPoints, int depth,
+                            Vec3f *verticesOut, Vec3f *normalsOut,
+                            memory::FrameArena &arena) {
+  revolveSubdividedCurve(
+      controlPoints, depth, revolutionSweep(controlPoints, depth, arena),
+      [verticesOut, normalsOut](std::size_t index, Vec3f const &vertex,
+                                Vec3f const &normal) {
+        verticesOut[index] = vertex;
+        normalsOut[index] = normal;
+      },
+      arena);
+}
+
+void revolvedGridRowsAffectedBy(std::size_t controlPointCount, int depth,
+                                std::size_t &first, std::size_t &last) {
+  subdividedRangeAffectedBy(controlPointCount, depth, first, last);
+
+  // normals are central differences, one row further on each side
+  auto profileSize = subdividedOpenCurveSize(controlPointCount, depth);
+  first = first > 0 ? first - 1 : 0;
+  last = std::min(last + 1, profileSize);
+}
+
+void revolvedGridBounds(Vertices const &controlPoints, Vec3f &boundsMin,
+                        Vec3f &boundsMax) {
+  if (controlPoints.empty()) {
+    boundsMin = boundsMax = Vec3f();
+    return;
+  }
+
+  // Chaikin points are convex combinations of the control points, so their
+  // y range and largest distance from the axis bound every slice
+  float radius = 0.f;
+  float yMin = controlPoints.front().y;
+  float yMax = yMin;
+  for (auto const &p : controlPoints) {
+    radius = std::max(radius, std::sqrt(p.x * p.x + p.z * p.z));
+    yMin = std::min(yMin, p.y);
+    yMax = std::max(yMax, p.y);
+  }
+
+  boundsMin = Vec3f(-radius, yMin, -radius);
+  boundsMax = Vec3f(radius, yMax, radius);
+}
+
+namespace {
+
+template <typename Index>
+void gridIndices(std::size_t profileSize, Index *indicesOut) {
+  if (profileSize < 2) {
+    return;
+  }
+
+  // Cells are emitted in bands GRID_BAND_WIDTH cells wide along the profile,
+  // each swept around every slice, so the row a slice shares with the next
+  // one is still in the post-transform cache when it is reused.
+  for (std::size_t bandFirst = 0; bandFirst + 1 < profileSize;
+       bandFirst += GRID_BAND_WIDTH) {
+    auto bandLast = std::min(bandFirst + GRID_BAND_WIDTH, profileSize - 1);
+
+    for (unsigned int slice = 0; slice < REVOLUTION_SLICES; ++slice) {
+      // last slice wraps back around to the first
+      unsigned int nextSlice = (slice + 1) % REVOLUTION_SLICES;
+
+      for (auto j = bandFirst; j < bandLast; ++j) {
+        Index a = slice * profileSize + j;
+        Index b = a + 1;
+        Index c = nextSlice * profileSize + j;
+        Index d = c + 1;
+
+        // first triangle
+        *indicesOut++ = a;
+        *indicesOut++ = b;
+        *indicesOut++ = c;
+
+        // second triangle
+        *indicesOut++ = c;
+        *indicesOut++ = b;
+        *indicesOut++ = d;
+      }
+    }
+  }
+}
+
+template <typename Index>
+void gridStripIndices(std::size_t profileSize, Index *indicesOut) {
+  if (profileSize < 2) {
+    return;
+  }
+
+  for (unsigned int slice = 0; slice < REVOLUTION_SLICES; ++slice) {
+    unsigned int nextSlice = (slice + 1) % REVOLUTION_SLICES;
+
+    if (slice > 0) {
+      *indicesOut++ = std::numeric_limits<Index>::max();
+    }
+
+    // Alternates this slice's row (a) and the next one's (c):
+    //   a0 a0 c0 a1 c1 a2 c2 ...
+    // The repeated first index is a degenerate triangle that flips the
+    // strip's parity, so cell j comes out as (a, b, c) (c, b, d) exactly as
+    // in the triangle list.
+    Index a = slice * profileSize;
+    Index c = nextSlice * profileSize;
+    *indicesOut++ = a;
+    for (std::size_t j = 0; j < profileSize; ++j) {
+      *indicesOut++ = a + j;
+      *indicesOut++ = c + j;
+    }
+  }
+}
+
+} // namespace
+
+void makeRevolvedGridIndices(std::size_t profileSize,
+                             unsigned short *indicesOut) {
+  gridIndices(profileSize, indicesOut);
+}
+
+void makeRevolvedGridIndices(std::size_t profileSize,
+                             unsigned int *indicesOut) {
+  gridIndices(profileSize, indicesOut);
+}
+
+void makeRevolvedGridStripIndices(std::size_t profileSize,
+                                  unsigned short *indicesOut) {
+  gridStripIndices(profileSize, indicesOut);
+}
+
+void makeRevolvedGridStripIndices(std::size_t profileSize,
+                                  unsigned int *indicesOut) {
+  gridStripIndices(profileSize, indicesOut);
+}
+
+} // namespace geometry
@@ -0,0 +1,53 @@
+#include "texture_buffer.hpp"
+
+#include <utility>
+
+#include "trace.hpp"
+
+namespace opengl {
+
+TextureBuffer::TextureBuffer(BufferObject buffer, Texture texture)
+    : m_buffer(std::move(buffer)), m_texture(std::move(texture)) {}
+
+void TextureBuffer::upload(void const *data, std::size_t bytes, GLenum usage) {
+  profiling::TraceScope trace("upload", "TextureBuffer::upload");
+
+  m_buffer.bind(BufferObject::TEXTURE);
+  glBufferData(GL_TEXTURE_BUFFER, bytes, NULL, usage);
+  if (bytes > 0) {
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+  }
+  m_buffer.unbind();
+
+  m_bytes = bytes;
+}
+
+void TextureBuffer::bind(GLuint unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_BUFFER, m_texture.id());
+}
+
+std::size_t TextureBuffer::bytes() const { return m_bytes; }
+
+TextureBuffer makeTextureBuffer(GLenum internalFormat) {
+  auto buffer = makeBufferObject();
+  auto texture = generateTexture();
+
+  // the attachment follows the buffer object, so later uploads that
+  // reallocate its storage need no new glTexBuffer
+  buffer.bind(BufferObject::TEXTURE);
+  glBindTexture(GL_TEXTURE_BUFFER, texture.id());
+  glTexBuffer(GL_TEXTURE_BUFFER, internalFormat, buffer.id());
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  buffer.unbind();
+
+  return TextureBuffer(std::move(buffer), std::move(texture));
+}
+
+std::size_t maxTextureBufferTexels() {
+  GLint texels = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &texels);
+  return texels > 0 ? texels : 0;
+}
+
+} // namespace opengl
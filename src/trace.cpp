@@ -0,0 +1,233 @@
+#include "trace.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace profiling {
+
+namespace {
+
+struct Event {
+  char const *category;
+  char const *name;
+  std::int64_t start;
+  std::int64_t end;
+  bool instant;
+};
+
+// one per thread that recorded or was named, shared between the thread
+// (thread_local) and the registry, so it outlives the thread until written
+struct ThreadEvents {
+  std::mutex mutex; // only contended while the trace is written
+  std::uint32_t id = 0;
+  std::string name;
+  std::vector<Event> events;
+};
+
+std::chrono::steady_clock::time_point const processStart =
+    std::chrono::steady_clock::now();
+
+struct Capture {
+  std::mutex mutex; // registry and capture state
+  std::vector<std::shared_ptr<ThreadEvents>> threads;
+  std::uint32_t nextThreadId = 1;
+
+  std::string filename;
+  std::size_t framesLeft = 0;
+  std::size_t frame = 0;
+};
+
+Capture &capture() {
+  static Capture instance;
+  return instance;
+}
+
+ThreadEvents &threadEvents() {
+  thread_local std::shared_ptr<ThreadEvents> events;
+  if (!events) {
+    events = std::make_shared<ThreadEvents>();
+
+    auto &state = capture();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    events->id = state.nextThreadId++;
+    state.threads.push_back(events);
+  }
+  return *events;
+}
+
+void recordEvent(Event const &event) {
+  auto &thread = threadEvents();
+  std::lock_guard<std::mutex> lock(thread.mutex);
+  thread.events.push_back(event);
+}
+
+void writeString(std::ostream &out, char const *text) {
+  out << '"';
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\') {
+      out << '\\';
+    }
+    out << *text;
+  }
+  out << '"';
+}
+
+// microseconds, the trace format's unit
+void writeTime(std::ostream &out, std::int64_t nanoseconds) {
+  out << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0')
+      << nanoseconds % 1000 << std::setfill(' ');
+}
+
+// Trace Event Format, "X" (complete) events for the scopes, an "i"
+// (instant) event per frame end, "M" (metadata) events for thread names
+bool writeTrace(Capture &state) {
+  std::ofstream out(state.filename);
+  if (!out) {
+    std::cerr << "[Error] could not write " << state.filename << '\n';
+    return false;
+  }
+
+  std::size_t eventCount = 0;
+  char const *separator = "\n";
+
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  for (auto const &thread : state.threads) {
+    std::lock_guard<std::mutex> lock(thread->mutex);
+
+    if (!thread->name.empty()) {
+      out << separator << "{\"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->id
+          << ", \"name\": \"thread_name\", \"args\": {\"name\": ";
+      writeString(out, thread->name.c_str());
+      out << "}}";
+      separator = ",\n";
+    }
+
+    for (auto const &event : thread->events) {
+      out << separator << "{\"ph\": \"" << (event.instant ? 'i' : 'X')
+          << "\", \"pid\": 1, \"tid\": " << thread->id << ", \"cat\": ";
+      writeString(out, event.category);
+      out << ", \"name\": ";
+      writeString(out, event.name);
+      out << ", \"ts\": ";
+      writeTime(out, event.start);
+      if (event.instant) {
+        // a line across every track
+        out << ", \"s\": \"g\"}";
+      } else {
+        out << ", \"dur\": ";
+        writeTime(out, event.end - event.start);
+        out << '}';
+      }
+      separator = ",\n";
+    }
+    eventCount += thread->events.size();
+  }
+  out << "\n]}\n";
+
+  if (!out) {
+    std::cerr << "[Error] could not write " << state.filename << '\n';
+    return false;
+  }
+
+  std::cout << "[Log] trace of " << state.frame << " frames (" << eventCount
+            << " events) written to " << state.filename << '\n';
+  return true;
+}
+
+// with state.mutex held
+void finishCapture(Capture &state) {
+  // scopes that already checked tracing() may still record, their threads'
+  // mutexes keep them apart from the writer
+  trace_detail::enabled = false;
+  writeTrace(state);
+  state.framesLeft = 0;
+}
+
+} // namespace
+
+namespace trace_detail {
+
+std::atomic<bool> enabled(false);
+
+std::int64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - processStart)
+      .count();
+}
+
+void record(char const *category, char const *name, std::int64_t start,
+            std::int64_t end) {
+  recordEvent({category, name, start, end, false});
+}
+
+} // namespace trace_detail
+
+constexpr std::int64_t TraceScope::NOT_RECORDING;
+
+void setTraceThreadName(std::string const &name) {
+  auto &thread = threadEvents();
+  std::lock_guard<std::mutex> lock(thread.mutex);
+  thread.name = name;
+}
+
+void startTrace(std::size_t frames, std::string const &filename) {
+  auto &state = capture();
+  std::lock_guard<std::mutex> lock(state.mutex);
+
+  trace_detail::enabled = false;
+
+  // threads that ended are only held here, everyone else starts over empty
+  std::vector<std::shared_ptr<ThreadEvents>> live;
+  for (auto &thread : state.threads) {
+    if (thread.use_count() > 1) {
+      std::lock_guard<std::mutex> threadLock(thread->mutex);
+      thread->events.clear();
+      live.push_back(thread);
+    }
+  }
+  state.threads.swap(live);
+
+  state.filename = filename;
+  state.framesLeft = frames;
+  state.frame = 0;
+
+  if (frames > 0) {
+    std::cout << "[Log] tracing the next " << frames << " frames\n";
+    trace_detail::enabled = true;
+  }
+}
+
+void traceFrameEnd() {
+  if (!tracing()) {
+    return;
+  }
+
+  auto time = trace_detail::now();
+  recordEvent({"frame", "frame end", time, time, true});
+
+  auto &state = capture();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.framesLeft == 0) {
+    return;
+  }
+
+  ++state.frame;
+  if (--state.framesLeft == 0) {
+    finishCapture(state);
+  }
+}
+
+void stopTrace() {
+  auto &state = capture();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (state.framesLeft > 0) {
+    finishCapture(state);
+  }
+}
+
+} // namespace profiling
@@ -1,58 +1,72 @@
 #include "vbo_tools.hpp"
 
 #include <algorithm>
-#include <unordered_map>
+#include <cassert>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <utility>
 
 #include "glad/glad.h"
 
+#include "flat_index_map.hpp"
+#include "trace.hpp"
+
 // Wont work for meshes that are in excess of #v * #uv * #n > max(size_t)
 // but that is around the mark of 10,000,000 x 10,000,000 x 1,000,000,
 // so we are probably fine
 
 namespace opengl {
 
-VBOData_Vertices makeConsistentVertexIndices(geometry::OBJMesh const &mesh) {
+namespace {
 
-  // simply copy the indices..
-  std::vector<unsigned int> indices;
-  indices.resize(mesh.triangles.size() * 3);
+// strip out just vertex IDs, written straight into exactly sized storage
+Indices vertexIDs(geometry::IndicesTriangles const &triangles) {
+  Indices indices(triangles.size() * 3);
 
-  // strip out just vertex IDs
-  for (auto const &t : mesh.triangles) {
-    indices.emplace_back(t.a().vertexID());
-    indices.emplace_back(t.b().vertexID());
-    indices.emplace_back(t.c().vertexID());
+  auto *out = indices.data();
+  for (auto const &t : triangles) {
+    *out++ = t.a().vertexID();
+    *out++ = t.b().vertexID();
+    *out++ = t.c().vertexID();
   }
 
-  return {indices, mesh.vertices};
+  return indices;
+}
+
+} // namespace
+
+VBOData_Vertices makeConsistentVertexIndices(geometry::OBJMesh const &mesh) {
+  return {vertexIDs(mesh.triangles), mesh.vertices};
+}
+
+VBOData_Vertices makeConsistentVertexIndices(geometry::OBJMesh &&mesh) {
+  auto indices = vertexIDs(mesh.triangles);
+  return {std::move(indices), std::move(mesh.vertices)};
 }
 
 VBOData_VerticesNormals
 makeConsistentVertexNormalIndices(geometry::OBJMesh const &mesh,
                                   geometry::Normals vertexNormals) {
+  profiling::TraceScope trace("vbo", "makeConsistentVertexNormalIndices");
+  return {vertexIDs(mesh.triangles), mesh.vertices, std::move(vertexNormals)};
+}
 
-  // simply copy the indices..
-  std::vector<unsigned int> indices;
-  indices.resize(mesh.triangles.size() * 3);
-
-  // strip out just vertex IDs
-  for (auto const &t : mesh.triangles) {
-    indices.emplace_back(t.a().vertexID());
-    indices.emplace_back(t.b().vertexID());
-    indices.emplace_back(t.c().vertexID());
-  }
-
-  return {indices, mesh.vertices, vertexNormals};
+VBOData_VerticesNormals
+makeConsistentVertexNormalIndices(geometry::OBJMesh &&mesh,
+                                  geometry::Normals vertexNormals) {
+  profiling::TraceScope trace("vbo", "makeConsistentVertexNormalIndices");
+  auto indices = vertexIDs(mesh.triangles);
+  return {std::move(indices), std::move(mesh.vertices),
+          std::move(vertexNormals)};
 }
 
 VBOData_VerticesNormals
 makeConsistentVertexNormalIndices(geometry::OBJMesh const &mesh) {
+  profiling::TraceScope trace("vbo", "makeConsistentVertexNormalIndices");
 
-  std::unordered_map<size_t, unsigned int> mappedIndices;
-  mappedIndices.reserve(mesh.vertices.size());
+  memory::FlatIndexMap mappedIndices(mesh.vertices.size());
 
   std::vector<unsigned int> indicesOut;
   indicesOut.reserve(mesh.triangles.size() *
@@ -75,38 +89,29 @@ makeConsistentVertexNormalIndices(geometry::OBJMesh const &mesh) {
     for (int idx = 0; idx < 3; ++idx) {
       auto index = t[idx];
 
-      auto key = keyGen(index.vertexID(), index.textureCoordID());
-
-      auto iter = mappedIndices.find(key);
-      if (iter != mappedIndices.end()) {
-        indicesOut.push_back(iter->second); // reuse id
-      } else {
+      auto key = keyGen(index.vertexID(), index.normalID());
 
-        unsigned int id = verticesOut.size();
+      // reuse id, or save a new one for next time
+      auto mapped = mappedIndices.findOrInsert(key, verticesOut.size());
+      indicesOut.push_back(mapped.first);
 
-        indicesOut.push_back(id); // new id
+      if (mapped.second) {
         verticesOut.push_back(mesh.vertices[index.vertexID()]);
         normalsOut.push_back(mesh.normals[index.normalID()]);
-
-        mappedIndices[key] = id; // save for next
       }
     }
   }
 
-  // optional
-  indicesOut.shrink_to_fit();
-  verticesOut.shrink_to_fit();
-  normalsOut.shrink_to_fit();
-
-  return {indicesOut, verticesOut, normalsOut};
+  // no shrink_to_fit, the buffers are moved out and uploaded as they are
+  return {std::move(indicesOut), std::move(verticesOut),
+          std::move(normalsOut)};
 }
 
 VBOData_VerticesTexutreCoordsNormals
 makeConsistentVertexTextureCoordNormalIndices(
     geometry::OBJMesh const &mesh, geometry::Normals const &vertexNormals) {
 
-  std::unordered_map<size_t, unsigned int> mappedIndices;
-  mappedIndices.reserve(mesh.vertices.size());
+  memory::FlatIndexMap mappedIndices(mesh.vertices.size());
 
   std::vector<unsigned int> indicesOut;
   indicesOut.reserve(mesh.triangles.size() *
@@ -138,39 +143,27 @@ makeConsistentVertexTextureCoordNormalIndices(
       auto key = keyGen(index.vertexID(),
                         index.textureCoordID()); // index.normalID());
 
-      auto iter = mappedIndices.find(key);
-      if (iter != mappedIndices.end()) {
-        auto vID = iter->second; // reuse existing id
-        indicesOut.push_back(vID);
-      } else {
-
-        unsigned int id = verticesOut.size();
+      // reuse existing id, or save a new one for next time
+      auto mapped = mappedIndices.findOrInsert(key, verticesOut.size());
+      indicesOut.push_back(mapped.first);
 
-        indicesOut.push_back(id); // new id
+      if (mapped.second) {
         verticesOut.push_back(mesh.vertices[index.vertexID()]);
         textureCoordsOut.push_back(mesh.textureCoords[index.textureCoordID()]);
         normalsOut.push_back(vertexNormals[index.vertexID()]);
-
-        mappedIndices[key] = id;
       }
     }
   }
 
-  // optional
-  indicesOut.shrink_to_fit();
-  verticesOut.shrink_to_fit();
-  textureCoordsOut.shrink_to_fit();
-  normalsOut.shrink_to_fit();
-
-  return {indicesOut, verticesOut, textureCoordsOut, normalsOut};
+  // no shrink_to_fit, the buffers are moved out and uploaded as they are
+  return {std::move(indicesOut), std::move(verticesOut),
+          std::move(normalsOut), std::move(textureCoordsOut)};
 }
 
 VBOData_VerticesTexutreCoordsNormals
 makeConsistentVertexTextureCoordNormalIndices(geometry::OBJMesh const &mesh) {
 
-  std::unordered_map<size_t, unsigned int> mappedIndices;
-  // std::map<size_t, unsigned int> mappedIndices;
-  mappedIndices.reserve(mesh.vertices.size());
+  memory::FlatIndexMap mappedIndices(mesh.vertices.size());
 
   std::vector<unsigned int> indicesOut;
   indicesOut.reserve(mesh.triangles.size() * 3);
@@ -201,252 +194,598 @@ makeConsistentVertexTextureCoordNormalIndices(geometry::OBJMesh const &mesh) {
       auto key =
           keyGen(index.vertexID(), index.textureCoordID(), index.normalID());
 
-      auto iter = mappedIndices.find(key);
-      if (iter != mappedIndices.end()) {
-        auto vID = iter->second; // reuse existing id
-        indicesOut.push_back(vID);
-      } else {
-
-        unsigned int id = verticesOut.size();
+      // reuse existing id, or save a new one for next time
+      auto mapped = mappedIndices.findOrInsert(key, verticesOut.size());
+      indicesOut.push_back(mapped.first);
 
-        indicesOut.push_back(id); // new id
+      if (mapped.second) {
         verticesOut.push_back(mesh.vertices[index.vertexID()]);
         textureCoordsOut.push_back(mesh.textureCoords[index.textureCoordID()]);
         normalsOut.push_back(mesh.normals[index.normalID()]);
+      }
+    }
+  }
+
+  // no shrink_to_fit, the buffers are moved out and uploaded as they are
+  return {std::move(indicesOut), std::move(verticesOut),
+          std::move(normalsOut), std::move(textureCoordsOut)};
+}
+
+namespace {
+
+constexpr unsigned int NO_INDEX = ~0u;
+
+// Forsyth's vertex score: recently used vertices score high (except the
+// last triangle's, which would just be reused for a degenerate fan), and
+// vertices with few triangles left get a boost so they are finished off
+float forsythVertexScore(int cachePosition, unsigned int remainingTriangles) {
+  if (remainingTriangles == 0) {
+    return -1.f;
+  }
+
+  float score = 0.f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      score = 0.75f;
+    } else {
+      float scaled = 1.f - float(cachePosition - 3) / (VERTEX_CACHE_SIZE - 3);
+      score = std::pow(scaled, 1.5f);
+    }
+  }
+
+  return score + 2.f / std::sqrt(float(remainingTriangles));
+}
+
+// old -> new vertex IDs in order of first use, indices are rewritten
+std::vector<unsigned int> firstUseRemap(Indices &indices,
+                                        std::size_t vertexCount,
+                                        unsigned int &usedCount) {
+  std::vector<unsigned int> remap(vertexCount, NO_INDEX);
+  usedCount = 0;
+  for (auto &index : indices) {
+    if (remap[index] == NO_INDEX) {
+      remap[index] = usedCount++;
+    }
+    index = remap[index];
+  }
+  return remap;
+}
+
+template <typename T>
+void applyRemap(std::vector<T> &attribute,
+                std::vector<unsigned int> const &remap,
+                unsigned int usedCount) {
+  std::vector<T> remapped(usedCount);
+  for (std::size_t v = 0; v < attribute.size(); ++v) {
+    if (remap[v] != NO_INDEX) {
+      remapped[remap[v]] = attribute[v];
+    }
+  }
+  attribute = std::move(remapped);
+}
 
-        mappedIndices[key] = id;
+} // namespace
+
+float averageCacheMissRatio(Indices const &indices, std::size_t vertexCount,
+                            unsigned int cacheSize) {
+  auto triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return 0.f;
+  }
+
+  // a vertex is in the FIFO if fewer than cacheSize misses happened since
+  // it was last loaded
+  std::vector<std::size_t> loadedAt(vertexCount, 0);
+  std::size_t misses = 0;
+  std::size_t time = cacheSize + 1;
+
+  for (auto index : indices) {
+    if (time - loadedAt[index] > cacheSize) {
+      loadedAt[index] = time++;
+      ++misses;
+    }
+  }
+
+  return float(misses) / triangleCount;
+}
+
+void optimizeVertexCache(Indices &indices, std::size_t vertexCount) {
+  auto triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // vertex -> triangle adjacency, the first remaining[v] entries of each
+  // vertex's range are the triangles not yet emitted
+  std::vector<unsigned int> remaining(vertexCount, 0);
+  for (auto index : indices) {
+    ++remaining[index];
+  }
+
+  std::vector<unsigned int> offsets(vertexCount + 1, 0);
+  for (std::size_t v = 0; v < vertexCount; ++v) {
+    offsets[v + 1] = offsets[v] + remaining[v];
+  }
+
+  std::vector<unsigned int> adjacency(indices.size());
+  {
+    std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+      for (int c = 0; c < 3; ++c) {
+        adjacency[fill[indices[3 * t + c]]++] = t;
       }
     }
   }
 
-  // optional
-  indicesOut.shrink_to_fit();
-  verticesOut.shrink_to_fit();
-  textureCoordsOut.shrink_to_fit();
-  normalsOut.shrink_to_fit();
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScore(vertexCount);
+  for (std::size_t v = 0; v < vertexCount; ++v) {
+    vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+  }
+
+  std::vector<float> triangleScore(triangleCount);
+  for (std::size_t t = 0; t < triangleCount; ++t) {
+    triangleScore[t] = vertexScore[indices[3 * t]] +
+                       vertexScore[indices[3 * t + 1]] +
+                       vertexScore[indices[3 * t + 2]];
+  }
 
-  return {indicesOut, verticesOut, textureCoordsOut, normalsOut};
+  std::vector<char> emitted(triangleCount, 0);
+  std::vector<unsigned int> cache;
+  std::vector<unsigned int> nextCache;
+  cache.reserve(VERTEX_CACHE_SIZE + 3);
+  nextCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+  Indices out;
+  out.reserve(indices.size());
+
+  std::size_t scanCursor = 0;
+  auto best = NO_INDEX;
+
+  for (std::size_t count = 0; count < triangleCount; ++count) {
+    if (best == NO_INDEX) {
+      // nothing left next to the cache, restart at the next unused triangle
+      while (emitted[scanCursor]) {
+        ++scanCursor;
+      }
+      best = scanCursor;
+    }
+
+    emitted[best] = 1;
+    unsigned int const triangle[3] = {indices[3 * best], indices[3 * best + 1],
+                                      indices[3 * best + 2]};
+
+    nextCache.clear();
+    for (auto v : triangle) {
+      out.push_back(v);
+      nextCache.push_back(v);
+
+      // drop the triangle from v's remaining list
+      auto first = adjacency.begin() + offsets[v];
+      auto last = first + remaining[v];
+      std::iter_swap(std::find(first, last, best), last - 1);
+      --remaining[v];
+    }
+
+    // the emitted triangle moves to the front of the LRU cache
+    for (auto v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        nextCache.push_back(v);
+      }
+    }
+
+    for (std::size_t i = 0; i < nextCache.size(); ++i) {
+      auto v = nextCache[i];
+      cachePosition[v] = i < VERTEX_CACHE_SIZE ? int(i) : -1;
+      vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+    }
+
+    // rescore triangles around the cache and pick the best for next time
+    best = NO_INDEX;
+    float bestScore = -1.f;
+    for (auto v : nextCache) {
+      for (auto i = offsets[v]; i < offsets[v] + remaining[v]; ++i) {
+        auto t = adjacency[i];
+        triangleScore[t] = vertexScore[indices[3 * t]] +
+                           vertexScore[indices[3 * t + 1]] +
+                           vertexScore[indices[3 * t + 2]];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          best = t;
+        }
+      }
+    }
+
+    if (nextCache.size() > VERTEX_CACHE_SIZE) {
+      nextCache.resize(VERTEX_CACHE_SIZE);
+    }
+    std::swap(cache, nextCache);
+  }
+
+  indices = std::move(out);
 }
 
-unsigned int setup_vao_and_buffers(opengl::VertexArrayObject &vao,
-                                   opengl::BufferObject &indexBuffer,
-                                   opengl::BufferObject &vertexBuffer,
-                                   opengl::VBOData_Vertices const &data) {
-  using namespace opengl;
+void optimizeOverdraw(Indices &indices, geometry::Vertices const &vertices) {
+  // clusters below this many triangles only split at hard boundaries
+  constexpr std::size_t MIN_CLUSTER_SIZE = 128;
 
-  vao.bind();
+  auto triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Cluster boundaries where the (FIFO) cache would mostly miss anyway:
+  // hard at triangles with 3 misses, soft at 2 once the cluster is large
+  // enough, so reordering the clusters barely changes the ACMR.
+  std::vector<std::size_t> clusterStarts;
+  {
+    std::vector<std::size_t> loadedAt(vertices.size(), 0);
+    std::size_t time = VERTEX_CACHE_SIZE + 1;
+    std::size_t clusterStart = 0;
+
+    for (std::size_t t = 0; t < triangleCount; ++t) {
+      int misses = 0;
+      for (int c = 0; c < 3; ++c) {
+        auto index = indices[3 * t + c];
+        if (time - loadedAt[index] > VERTEX_CACHE_SIZE) {
+          loadedAt[index] = time++;
+          ++misses;
+        }
+      }
+
+      if (t == 0 || misses == 3 ||
+          (misses == 2 && t - clusterStart >= MIN_CLUSTER_SIZE)) {
+        clusterStarts.push_back(t);
+        clusterStart = t;
+      }
+    }
+    clusterStarts.push_back(triangleCount);
+  }
 
-  auto indexSize = sizeof(unsigned int) * (data.indices.size());
-  indexBuffer.bind(BufferObject::ELEMENT_ARRAY);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, // type
-               indexSize,               // size
-               data.indices.data(),     // data
-               GL_STATIC_DRAW);
+  math::Vec3f meshCentre;
+  for (auto const &v : vertices) {
+    meshCentre += v;
+  }
+  meshCentre /= float(std::max<std::size_t>(vertices.size(), 1));
 
-  // set up position input into vertex shader
-  auto vertexSize = sizeof(math::Vec3f) * data.vertices.size();
-  auto totalSize = vertexSize;
+  // sort key: how much the cluster faces away from the centre of the mesh
+  struct Cluster {
+    std::size_t first;
+    std::size_t last;
+    float key;
+  };
 
-  auto vertexOffset = size_t(0);
+  std::vector<Cluster> clusters;
+  clusters.reserve(clusterStarts.size() - 1);
+
+  for (std::size_t i = 0; i + 1 < clusterStarts.size(); ++i) {
+    math::Vec3f centre;
+    math::Vec3f normal; // area weighted
+    for (auto t = clusterStarts[i]; t < clusterStarts[i + 1]; ++t) {
+      auto const &a = vertices[indices[3 * t]];
+      auto const &b = vertices[indices[3 * t + 1]];
+      auto const &c = vertices[indices[3 * t + 2]];
+      centre += a + b + c;
+      normal += (b - a) ^ (c - a);
+    }
+    centre /= 3.f * (clusterStarts[i + 1] - clusterStarts[i]);
 
-  vertexBuffer.bind(BufferObject::ARRAY);
+    clusters.push_back(
+        {clusterStarts[i], clusterStarts[i + 1], (centre - meshCentre) * normal});
+  }
 
-  // positions
-  glEnableVertexAttribArray(0); // match layout # in vertex shader
-  glVertexAttribPointer(        //
-      0,                        // attribute layout # (in shader)
-      3,                        // number of coordinates per vertex
-      GL_FLOAT,                 // type
-      GL_FALSE,                 // normalized?
-      sizeof(math::Vec3f),      // stride
-      (void *)(vertexOffset)    // array buffer offset
-      );
-
-  // request storage, but provide no data
-  // [ vertices | normals | uvs ]
-  glBufferData(GL_ARRAY_BUFFER, totalSize, NULL, GL_STATIC_DRAW);
-
-  // load positions
-  // [ v | v | v | ]
-  glBufferSubData(GL_ARRAY_BUFFER,       // type
-                  0,                     // offset
-                  vertexSize,            // size
-                  data.vertices.data()); // data pointer
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](Cluster const &lhs, Cluster const &rhs) {
+                     return lhs.key > rhs.key;
+                   });
 
-  vao.unbind();
-  indexBuffer.unbind();
-  vertexBuffer.unbind();
+  Indices out;
+  out.reserve(indices.size());
+  for (auto const &cluster : clusters) {
+    out.insert(out.end(), indices.begin() + 3 * cluster.first,
+               indices.begin() + 3 * cluster.last);
+  }
 
-  return data.indices.size();
+  indices = std::move(out);
 }
 
-unsigned int setup_vao_and_buffers(opengl::VertexArrayObject &vao,
-                                   opengl::BufferObject &indexBuffer,
-                                   opengl::BufferObject &vertexBuffer,
-                                   VBOData_VerticesNormals const &data) {
-  using namespace opengl;
+void optimizeVertexFetch(VBOData_VerticesNormals &data) {
+  unsigned int usedCount = 0;
+  auto remap = firstUseRemap(data.indices, data.vertices.size(), usedCount);
 
-  vao.bind();
+  applyRemap(data.vertices, remap, usedCount);
+  applyRemap(data.normals, remap, usedCount);
+}
 
-  // bind these indices
-  auto indexSize = sizeof(unsigned int) * (data.indices.size());
-  indexBuffer.bind(BufferObject::ELEMENT_ARRAY);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, // type
-               indexSize,               // size
-               data.indices.data(),     // data
-               GL_STATIC_DRAW);
+void optimizeVertexFetch(VBOData_VerticesTexutreCoordsNormals &data) {
+  unsigned int usedCount = 0;
+  auto remap = firstUseRemap(data.indices, data.vertices.size(), usedCount);
 
-  // set up position input into vertex shader
-  auto vertexSize = sizeof(math::Vec3f) * data.vertices.size();
-  auto normalsSize = sizeof(math::Vec3f) * data.normals.size();
-  auto totalSize = vertexSize + normalsSize;
+  applyRemap(data.vertices, remap, usedCount);
+  applyRemap(data.textureCoords, remap, usedCount);
+  applyRemap(data.normals, remap, usedCount);
+}
 
-  auto verticesOffset = size_t(0);
-  auto normalsOffset = vertexSize;
+IndexOrderReport optimizeIndexOrder(VBOData_VerticesNormals &data,
+                                    bool sortForOverdraw) {
+  profiling::TraceScope trace("vbo", "optimizeIndexOrder");
 
-  vertexBuffer.bind(BufferObject::ARRAY);
+  IndexOrderReport report;
+  report.acmrBefore = averageCacheMissRatio(data.indices, data.vertices.size());
 
-  // vao setup
-  // positions
-  glEnableVertexAttribArray(0); // match layout # in vertex shader
-  glVertexAttribPointer(        //
-      0,                        // attribute layout # (in shader)
-      3,                        // number of coordinates per vertex
-      GL_FLOAT,                 // type
-      GL_FALSE,                 // normalized?
-      sizeof(math::Vec3f),      // stride
-      (void *)(verticesOffset)  // array buffer offset
-      );
-
-  // normals
-  glEnableVertexAttribArray(1); // match layout # in vertex shader
-  glVertexAttribPointer(        //
-      1,                        // attribute layout # (in shader)
-      3,                        // number of coordinates per vertex
-      GL_FLOAT,                 // type
-      GL_FALSE,                 // normalized?
-      sizeof(math::Vec3f),      // stride
-      (void *)(normalsOffset)   // array buffer offset
-      );
-
-  // request storage, but provide no data
-  // [ vertices | normals | uvs ]
-  glBufferData(GL_ARRAY_BUFFER, totalSize, NULL, GL_STATIC_DRAW);
-
-  // load positions
-  // [ v | v | v | ... | *uninitialized* ]
-  glBufferSubData(GL_ARRAY_BUFFER,       // type
-                  verticesOffset,        // offset
-                  vertexSize,            // size
-                  data.vertices.data()); // data pointer
-
-  // load normals
-  // [ v | v | v | ... | n | n | n | ]
-  glBufferSubData(GL_ARRAY_BUFFER,      // type
-                  normalsOffset,        // offset
-                  normalsSize,          // size
-                  data.normals.data()); // data pointer
+  // small or already well ordered meshes can come out worse, keep those
+  auto original = data.indices;
+  optimizeVertexCache(data.indices, data.vertices.size());
+  if (averageCacheMissRatio(data.indices, data.vertices.size()) >
+      report.acmrBefore) {
+    data.indices = std::move(original);
+  }
 
-  vao.unbind();
-  indexBuffer.unbind();
-  vertexBuffer.unbind();
+  if (sortForOverdraw) {
+    optimizeOverdraw(data.indices, data.vertices);
+  }
+  optimizeVertexFetch(data);
 
-  return data.indices.size();
+  report.acmrAfter = averageCacheMissRatio(data.indices, data.vertices.size());
+  return report;
 }
 
-unsigned int
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  opengl::VBOData_Vertices const &data,
+                                  VertexStorage storage) {
+  // [ v | v | v | ]
+  return setup_vao_and_buffers<VertexLayout<Position>>(vao, indexBuffer,
+                                                       vertexBuffer, data,
+                                                       storage);
+}
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  VBOData_VerticesNormals const &data,
+                                  VertexStorage storage) {
+  // [ v | v | v | ... | n | n | n | ] or [ v | n | v | n | ... ]
+  return setup_vao_and_buffers<LayoutVerticesNormals>(vao, indexBuffer,
+                                                      vertexBuffer, data,
+                                                      storage);
+}
+
+IndexedDraw
 setup_vao_and_buffers(opengl::VertexArrayObject &vao,
                       opengl::BufferObject &indexBuffer,
                       opengl::BufferObject &vertexBuffer,
-                      VBOData_VerticesTexutreCoordsNormals const &data) {
+                      VBOData_VerticesTexutreCoordsNormals const &data,
+                      VertexStorage storage) {
+  // [ v | v | v | .. | n | n | n | ... | uv | uv | uv ] or [ v | n | uv | ... ]
+  return setup_vao_and_buffers<LayoutVerticesNormalsTextureCoords>(
+      vao, indexBuffer, vertexBuffer, data, storage);
+}
+
+namespace {
+
+// Maps planar [ vertices | normals ] storage for the bound VAO's vertex
+// buffer and hands both arrays to fill
+template <typename Layout, typename VertexT, typename NormalT>
+void fillMappedVertices(
+    std::size_t vertexCount,
+    std::function<void(VertexT *vertices, NormalT *normals)> const &fill) {
+  Layout::setupAttributes(vertexCount, VertexStorage::Planar);
+
+  auto normalsOffset = sizeof(VertexT) * vertexCount;
+  fillBufferMapped(GL_ARRAY_BUFFER, Layout::vertexSize() * vertexCount,
+                   GL_DYNAMIC_DRAW, [&](void *data) {
+                     auto *bytes = static_cast<char *>(data);
+                     fill(reinterpret_cast<VertexT *>(bytes),
+                          reinterpret_cast<NormalT *>(bytes + normalsOffset));
+                   });
+}
+
+// Stages just the vertices of ranges in scratch, back to back, then sends
+// them to both planar arrays with glBufferSubData. Returns the bytes uploaded.
+template <typename VertexT, typename NormalT>
+std::size_t updatePlanarRanges(
+    opengl::BufferObject &vertexBuffer, std::size_t vertexCount,
+    std::vector<VertexRange> const &ranges,
+    std::function<void(VertexT *vertices, NormalT *normals)> const &fill,
+    memory::FrameArena &scratch) {
+  profiling::TraceScope trace("vbo", "update_vertex_ranges");
+
+  std::size_t staged = 0;
+  for (std::size_t r = 0; r < ranges.size(); ++r) {
+    assert(ranges[r].first + ranges[r].count <= vertexCount);
+    assert(r == 0 ||
+           ranges[r - 1].first + ranges[r - 1].count <= ranges[r].first);
+    staged += ranges[r].count;
+  }
+
+  if (staged == 0) {
+    return 0;
+  }
+
+  auto *vertices = static_cast<VertexT *>(
+      scratch.allocate(sizeof(VertexT) * staged, alignof(VertexT)));
+  auto *normals = static_cast<NormalT *>(
+      scratch.allocate(sizeof(NormalT) * staged, alignof(NormalT)));
+  fill(vertices, normals);
+
+  auto normalsOffset = sizeof(VertexT) * vertexCount;
+  std::size_t bytes = 0;
+
+  profiling::TraceScope uploadTrace("upload", "glBufferSubData ranges");
+  vertexBuffer.bind(BufferObject::ARRAY);
+  // ranges that touch are contiguous in the buffer and in staging alike, so
+  // each run of them is sent at once
+  std::size_t stagedFirst = 0;
+  for (std::size_t r = 0; r < ranges.size();) {
+    auto first = ranges[r].first;
+    auto count = ranges[r].count;
+    for (++r; r < ranges.size() && ranges[r].first == first + count; ++r) {
+      count += ranges[r].count;
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    // [ vertices | normals ]
+    glBufferSubData(GL_ARRAY_BUFFER,         // type
+                    sizeof(VertexT) * first, // offset
+                    sizeof(VertexT) * count, // size
+                    vertices + stagedFirst); // data pointer
+    glBufferSubData(GL_ARRAY_BUFFER,                         // type
+                    normalsOffset + sizeof(NormalT) * first, // offset
+                    sizeof(NormalT) * count,                 // size
+                    normals + stagedFirst);                  // data pointer
+    bytes += (sizeof(VertexT) + sizeof(NormalT)) * count;
+    stagedFirst += count;
+  }
+  vertexBuffer.unbind();
+
+  return bytes;
+}
+
+} // namespace
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices,
+                                  FillVerticesNormals const &fill) {
   using namespace opengl;
+  profiling::TraceScope trace("vbo", "setup_vao_and_buffers");
+
+  if (vertexCount == 0 || indices.count == 0) {
+    return IndexedDraw();
+  }
 
   vao.bind();
+  auto draw = indexBuffers.bind(indices, vertexCount);
+
+  vertexBuffer.bind(BufferObject::ARRAY);
+  fillMappedVertices<LayoutVerticesNormals>(vertexCount, fill);
+
+  vao.unbind();
+  vertexBuffer.unbind();
 
-  // bind these indices
-  auto indexSize = sizeof(unsigned int) * (data.indices.size());
-  indexBuffer.bind(BufferObject::ELEMENT_ARRAY);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, // type
-               indexSize,               // size
-               data.indices.data(),     // data
-               GL_STATIC_DRAW);
+  return draw;
+}
 
-  // set up position input into vertex shader
-  auto vertexSize = sizeof(math::Vec3f) * data.vertices.size();
-  auto textureCoordSize = sizeof(math::Vec2f) * data.textureCoords.size();
-  auto normalsSize = sizeof(math::Vec3f) * data.normals.size();
-  auto totalSize = vertexSize + normalsSize + textureCoordSize;
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices) {
+  using namespace opengl;
+  profiling::TraceScope trace("vbo", "setup_vao_and_buffers");
 
-  auto verticesOffset = size_t(0);
-  auto normalsOffset = vertexSize;
-  auto textureCoordsOffset = vertexSize + normalsSize;
+  if (vertexCount == 0 || indices.count == 0) {
+    return IndexedDraw();
+  }
+
+  vao.bind();
+  auto draw = indexBuffers.bind(indices, vertexCount);
 
   vertexBuffer.bind(BufferObject::ARRAY);
+  LayoutVerticesNormals::setupAttributes(vertexCount,
+                                         VertexStorage::Interleaved);
+
+  vao.unbind();
+  vertexBuffer.unbind();
+
+  return draw;
+}
 
-  // vao setup
-  // positions
-  glEnableVertexAttribArray(0); // match layout # in vertex shader
-  glVertexAttribPointer(        //
-      0,                        // attribute layout # (in shader)
-      3,                        // number of coordinates per vertex
-      GL_FLOAT,                 // type
-      GL_FALSE,                 // normalized?
-      sizeof(math::Vec3f),      // stride
-      (void *)(verticesOffset)  // array buffer offset
-      );
-
-  // normals
-  glEnableVertexAttribArray(1); // match layout # in vertex shader
-  glVertexAttribPointer(        //
-      1,                        // attribute layout # (in shader)
-      3,                        // number of coordinates per vertex
-      GL_FLOAT,                 // type
-      GL_FALSE,                 // normalized?
-      sizeof(math::Vec3f),      // stride
-      (void *)(normalsOffset)   // array buffer offset
-      );
-
-  // texture coords
-  glEnableVertexAttribArray(2);     // match layout # in vertex shader
-  glVertexAttribPointer(            //
-      2,                            // attribute layout # (in shader)
-      2,                            // number of coordinates per vertex
-      GL_FLOAT,                     // type
-      GL_FALSE,                     // normalized?
-      sizeof(math::Vec2f),          // stride
-      (void *)(textureCoordsOffset) // array buffer offset
-      );
-
-  // request storage, but provide no data
-  // [ vertices| uvs | normals ]
-  glBufferData(GL_ARRAY_BUFFER, totalSize, NULL, GL_STATIC_DRAW);
-
-  // load positions
-  // [ v | v | v | ... | *uninitialized* ]
-  glBufferSubData(GL_ARRAY_BUFFER,       // type
-                  verticesOffset,        // offset
-                  vertexSize,            // size
-                  data.vertices.data()); // data pointer
-
-  // load normals
-  // [ v | v | v | .. | n | n | n | ... | *unitialized* ]
-  glBufferSubData(GL_ARRAY_BUFFER,      // type
-                  normalsOffset,        // offset
-                  normalsSize,          // size
-                  data.normals.data()); // data pointer
-
-  // load uvs
-  // [ v | v | v | .. | n | n | n | ... | uv | uv | uv ]
-  glBufferSubData(GL_ARRAY_BUFFER,            // type
-                  textureCoordsOffset,        // offset
-                  textureCoordSize,           // size
-                  data.textureCoords.data()); // data pointer
+std::size_t update_vertex_ranges(opengl::BufferObject &vertexBuffer,
+                                 std::size_t vertexCount,
+                                 std::vector<VertexRange> const &ranges,
+                                 FillVerticesNormals const &fill,
+                                 memory::FrameArena &scratch) {
+  return updatePlanarRanges(vertexBuffer, vertexCount, ranges, fill, scratch);
+}
+
+namespace {
+
+// the vertices and normals of data into packed, the indices are left to the
+// caller to copy or move
+void packVertexAttributes(VBOData_VerticesNormals const &data,
+                          VBOData_PackedVerticesNormals &packed) {
+  packed.quantization = quantizationFor(data.vertices);
+
+  packed.vertices.reserve(data.vertices.size());
+  for (auto const &v : data.vertices) {
+    packed.vertices.push_back(packPosition(v, packed.quantization));
+  }
+
+  packed.normals.reserve(data.normals.size());
+  for (auto const &n : data.normals) {
+    packed.normals.push_back(packNormal(n));
+  }
+}
+
+} // namespace
+
+VBOData_PackedVerticesNormals
+packVerticesNormals(VBOData_VerticesNormals const &data) {
+  profiling::TraceScope trace("vbo", "packVerticesNormals");
+
+  VBOData_PackedVerticesNormals packed;
+  packed.indices = data.indices;
+  packVertexAttributes(data, packed);
+  return packed;
+}
+
+VBOData_PackedVerticesNormals
+packVerticesNormals(VBOData_VerticesNormals &&data) {
+  profiling::TraceScope trace("vbo", "packVerticesNormals");
+
+  VBOData_PackedVerticesNormals packed;
+  packed.indices = std::move(data.indices);
+  packVertexAttributes(data, packed);
+  return packed;
+}
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::BufferObject &indexBuffer,
+                                  opengl::BufferObject &vertexBuffer,
+                                  VBOData_PackedVerticesNormals const &data,
+                                  VertexStorage storage) {
+  return setup_vao_and_buffers<LayoutPackedVerticesNormals>(
+      vao, indexBuffer, vertexBuffer, data, storage);
+}
+
+IndexedDraw setup_vao_and_buffers(opengl::VertexArrayObject &vao,
+                                  opengl::IndexBufferCache &indexBuffers,
+                                  opengl::BufferObject &vertexBuffer,
+                                  std::size_t vertexCount,
+                                  IndexRequest const &indices,
+                                  FillPackedVerticesNormals const &fill) {
+  using namespace opengl;
+  profiling::TraceScope trace("vbo", "setup_vao_and_buffers");
+
+  if (vertexCount == 0 || indices.count == 0) {
+    return IndexedDraw();
+  }
+
+  vao.bind();
+  auto draw = indexBuffers.bind(indices, vertexCount);
+
+  vertexBuffer.bind(BufferObject::ARRAY);
+  fillMappedVertices<LayoutPackedVerticesNormals>(vertexCount, fill);
 
   vao.unbind();
-  indexBuffer.unbind();
   vertexBuffer.unbind();
 
-  return data.indices.size();
+  return draw;
+}
+
+std::size_t update_vertex_ranges(opengl::BufferObject &vertexBuffer,
+                                 std::size_t vertexCount,
+                                 std::vector<VertexRange> const &ranges,
+                                 FillPackedVerticesNormals const &fill,
+                                 memory::FrameArena &scratch) {
+  return updatePlanarRanges(vertexBuffer, vertexCount, ranges, fill, scratch);
 }
 
 } // namespace opengl
@@ -0,0 +1,121 @@
+#include "vertex_packing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace math;
+
+namespace opengl {
+
+namespace {
+
+float signNotZero(float v) { return v < 0.f ? -1.f : 1.f; }
+
+std::uint16_t toUnorm16(float v) {
+  return std::uint16_t(std::lround(std::min(std::max(v, 0.f), 1.f) * 65535.f));
+}
+
+std::int16_t toSnorm16(float v) {
+  return std::int16_t(std::lround(std::min(std::max(v, -1.f), 1.f) * 32767.f));
+}
+
+} // namespace
+
+bool operator==(PositionQuantization const &lhs,
+                PositionQuantization const &rhs) {
+  for (int i = 0; i < 3; ++i) {
+    if (lhs.offset[i] != rhs.offset[i] || lhs.scale[i] != rhs.scale[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool operator!=(PositionQuantization const &lhs,
+                PositionQuantization const &rhs) {
+  return !(lhs == rhs);
+}
+
+PositionQuantization quantizationForBounds(Vec3f const &boundsMin,
+                                           Vec3f const &boundsMax) {
+  PositionQuantization quantization;
+  quantization.offset = boundsMin;
+
+  // flat extents still get a non zero scale so decoding stays finite
+  auto extent = boundsMax - boundsMin;
+  for (int i = 0; i < 3; ++i) {
+    quantization.scale[i] = extent[i] > 0.f ? extent[i] : 1.f;
+  }
+
+  return quantization;
+}
+
+PositionQuantization quantizationFor(geometry::Vertices const &vertices) {
+  if (vertices.empty()) {
+    return {};
+  }
+
+  Vec3f boundsMin = vertices.front();
+  Vec3f boundsMax = vertices.front();
+  for (auto const &v : vertices) {
+    for (int i = 0; i < 3; ++i) {
+      boundsMin[i] = std::min(boundsMin[i], v[i]);
+      boundsMax[i] = std::max(boundsMax[i], v[i]);
+    }
+  }
+
+  return quantizationForBounds(boundsMin, boundsMax);
+}
+
+PackedPosition packPosition(Vec3f const &position,
+                            PositionQuantization const &quantization) {
+  auto const &o = quantization.offset;
+  auto const &s = quantization.scale;
+  return {toUnorm16((position.x - o.x) / s.x),
+          toUnorm16((position.y - o.y) / s.y),
+          toUnorm16((position.z - o.z) / s.z), 0};
+}
+
+PackedNormal packNormal(Vec3f const &normal) {
+  // project onto the octahedron |x| + |y| + |z| = 1, then fold the lower
+  // half over the upper one
+  float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+  if (l1 == 0.f) {
+    return {0, 0};
+  }
+
+  float x = normal.x / l1;
+  float y = normal.y / l1;
+  if (normal.z < 0.f) {
+    float foldedX = (1.f - std::abs(y)) * signNotZero(x);
+    float foldedY = (1.f - std::abs(x)) * signNotZero(y);
+    x = foldedX;
+    y = foldedY;
+  }
+
+  return {toSnorm16(x), toSnorm16(y)};
+}
+
+Vec3f unpackPosition(PackedPosition const &position,
+                     PositionQuantization const &quantization) {
+  auto const &o = quantization.offset;
+  auto const &s = quantization.scale;
+  return Vec3f(o.x + s.x * (position.x / 65535.f),
+               o.y + s.y * (position.y / 65535.f),
+               o.z + s.z * (position.z / 65535.f));
+}
+
+Vec3f unpackNormal(PackedNormal const &normal) {
+  float x = std::max(normal.x / 32767.f, -1.f);
+  float y = std::max(normal.y / 32767.f, -1.f);
+  float z = 1.f - std::abs(x) - std::abs(y);
+  if (z < 0.f) {
+    float unfoldedX = (1.f - std::abs(y)) * signNotZero(x);
+    float unfoldedY = (1.f - std::abs(x)) * signNotZero(y);
+    x = unfoldedX;
+    y = unfoldedY;
+  }
+  return normalized(Vec3f(x, y, z));
+}
+
+} // namespace opengl
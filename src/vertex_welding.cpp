@@ -0,0 +1,120 @@
+#include "vertex_welding.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "flat_index_map.hpp"
+
+using namespace math;
+
+namespace geometry {
+
+namespace {
+
+constexpr unsigned int NO_VERTEX = ~0u;
+
+struct Cell {
+  std::int64_t x;
+  std::int64_t y;
+  std::int64_t z;
+};
+
+Cell cellOf(Vec3f const &p, float inverseCellSize) {
+  return {std::int64_t(std::floor(p.x * inverseCellSize)),
+          std::int64_t(std::floor(p.y * inverseCellSize)),
+          std::int64_t(std::floor(p.z * inverseCellSize))};
+}
+
+// Spatial hash of a cell. Different cells may share a key, which only puts
+// them in the same bucket since candidates are always distance checked.
+std::size_t cellKey(std::int64_t x, std::int64_t y, std::int64_t z) {
+  auto key = std::size_t(std::uint64_t(x) * 73856093u ^
+                         std::uint64_t(y) * 19349663u ^
+                         std::uint64_t(z) * 83492791u);
+  return key == ~std::size_t(0) ? 0 : key; // ~0 marks empty map slots
+}
+
+} // namespace
+
+std::size_t weldVertices(OBJMesh &mesh, float epsilon) {
+  assert(epsilon > 0.f);
+
+  auto &vertices = mesh.vertices;
+  float const inverseCellSize = 1.f / epsilon;
+  float const epsilonSquared = epsilon * epsilon;
+
+  std::vector<unsigned int> remap(vertices.size());
+
+  // each bucket is a singly linked list of unique vertices, the map holds the
+  // head and nextInBucket the links
+  memory::FlatIndexMap bucketHeads(vertices.size());
+  std::vector<unsigned int> nextInBucket;
+  nextInBucket.reserve(vertices.size());
+
+  unsigned int uniqueCount = 0;
+
+  for (std::size_t i = 0; i < vertices.size(); ++i) {
+    Vec3f const p = vertices[i];
+    Cell const cell = cellOf(p, inverseCellSize);
+
+    unsigned int match = NO_VERTEX;
+    for (int dz = -1; dz <= 1 && match == NO_VERTEX; ++dz) {
+      for (int dy = -1; dy <= 1 && match == NO_VERTEX; ++dy) {
+        for (int dx = -1; dx <= 1 && match == NO_VERTEX; ++dx) {
+          auto const *head =
+              bucketHeads.find(cellKey(cell.x + dx, cell.y + dy, cell.z + dz));
+
+          for (auto id = head ? *head : NO_VERTEX; id != NO_VERTEX;
+               id = nextInBucket[id]) {
+            if (distanceSquared(vertices[id], p) <= epsilonSquared) {
+              match = id;
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    if (match != NO_VERTEX) {
+      remap[i] = match;
+      continue;
+    }
+
+    // new unique vertex, ids never pass i so compacting in place is safe
+    unsigned int id = uniqueCount++;
+    vertices[id] = p;
+    remap[i] = id;
+
+    auto key = cellKey(cell.x, cell.y, cell.z);
+    auto head = bucketHeads.findOrInsert(key, id);
+    if (head.second) {
+      nextInBucket.push_back(NO_VERTEX);
+    } else {
+      nextInBucket.push_back(head.first);
+      *bucketHeads.find(key) = id;
+    }
+  }
+
+  vertices.resize(uniqueCount);
+
+  // remap triangles, dropping any that welded shut
+  auto out = mesh.triangles.begin();
+  for (auto t : mesh.triangles) {
+    for (int idx = 0; idx < 3; ++idx) {
+      t[idx].vertexID() = remap[t[idx].vertexID()];
+    }
+
+    if (t.a().vertexID() != t.b().vertexID() &&
+        t.b().vertexID() != t.c().vertexID() &&
+        t.a().vertexID() != t.c().vertexID()) {
+      *out++ = t;
+    }
+  }
+  mesh.triangles.erase(out, mesh.triangles.end());
+
+  return uniqueCount;
+}
+
+} // namespace geometry